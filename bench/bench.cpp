@@ -0,0 +1,307 @@
+#include "bench.hpp"
+
+#include <chrono>
+#include <limits>
+
+#include "glh/null_gl.hpp"
+#include "glh/resource.hpp"
+
+namespace {
+
+constexpr float kDeltaTime = 1.0f / 60.0f;
+
+ParticleEmitParams default_emit_params(float life_min, float life_max) {
+    ParticleEmitParams params {};
+    params.position = glm::vec3(0.0f);
+    params.position_radius = 1.0f;
+    params.velocity = glm::vec3(0.0f, 5.0f, 0.0f);
+    params.velocity_angle_cos = 0.5f;
+    params.mass_min = 0.5f;
+    params.mass_max = 2.0f;
+    params.life_min = life_min;
+    params.life_max = life_max;
+    params.size_min = 0.05f;
+    params.size_max = 0.05f;
+    return params;
+}
+
+// emission, update and compaction of 'frame', sets whether emission and compaction ran
+void run_frame(ParticleBackend &backend, const BenchScenario &scenario, uint32_t frame, bool &emit, bool &compact) {
+    emit = frame % scenario.emit_interval == 0;
+    compact = (frame + 1) % scenario.compact_interval == 0;
+    if (emit) {
+        auto params = scenario.emit;
+        params.count = scenario.emit_count;
+        params.seed = frame;
+        backend.emit(params);
+    }
+    backend.update(scenario.update, compact);
+    if (compact) {
+        backend.compact();
+    }
+    backend.end_frame();
+}
+
+}
+
+std::vector<BenchScenario> bench_scenarios(uint32_t compact_interval) {
+    const ParticleUpdateParams update { glm::vec3(0.0f), kDeltaTime, 9.8f, 0.1f };
+
+    // 262144 particles living 2 s on average, with as many emitted as dying every frame
+    const uint32_t steady_count = 262144;
+    const float steady_life = 2.0f;
+    const uint32_t steady_emit_count = static_cast<uint32_t>(steady_count * kDeltaTime / steady_life);
+
+    return {
+        {
+            "steady", "262144 particles in steady state, compacted every frame",
+            default_emit_params(steady_life - 0.5f, steady_life + 0.5f), steady_emit_count, 1, 1, update,
+        },
+        {
+            "burst", "bursts of 131072 particles every second, living half a second to a second",
+            default_emit_params(0.5f, 1.0f), 131072, 60, 1, update,
+        },
+        {
+            "churn", "131072 particles emitted every frame, living one or two frames",
+            default_emit_params(0.5f * kDeltaTime, 2.0f * kDeltaTime), 131072, 1, 1, update,
+        },
+        {
+            "compact_interval", "262144 particles in steady state, compacted every few frames",
+            default_emit_params(steady_life - 0.5f, steady_life + 0.5f), steady_emit_count, 1, compact_interval,
+            update,
+        },
+    };
+}
+
+BenchResult run_bench(
+    ParticleBackend &backend, const BenchScenario &scenario, uint32_t num_warmup_frames, uint32_t num_frames,
+    GlUploadRing *upload_ring
+) {
+    using Clock = std::chrono::steady_clock;
+
+    BenchResult result;
+    result.scenario = scenario.name;
+    result.backend = backend.name();
+    result.num_frames = num_frames;
+
+    backend.reset();
+
+    ParticleBackend::StageStats warmup_stats[ParticleBackend::eNumStages];
+    uint32_t num_executions[ParticleBackend::eNumStages] = {};
+    Clock::time_point begin_time;
+    double sum_num_particles = 0.0;
+    bool null_gl = null_gl_loaded();
+    uint32_t num_gl_calls[eNumNullGlFunctions] = {};
+    double gl_call_ns[eNumNullGlFunctions] = {};
+
+    for (uint32_t frame = 0; frame < num_warmup_frames + num_frames; frame++) {
+        bool measured = frame >= num_warmup_frames;
+        if (frame == num_warmup_frames) {
+            // stage times of warmup frames are left out
+            backend.finish();
+            for (uint32_t stage = 0; stage < ParticleBackend::eNumStages; stage++) {
+                warmup_stats[stage] = backend.stage_stats(stage);
+            }
+            begin_time = Clock::now();
+        }
+
+        auto frame_begin_time = Clock::now();
+        if (null_gl) {
+            clear_null_gl_calls();
+        }
+        if (upload_ring) {
+            upload_ring->begin_frame();
+        }
+
+        bool emit;
+        bool compact;
+        run_frame(backend, scenario, frame, emit, compact);
+
+        if (upload_ring) {
+            upload_ring->end_frame();
+        }
+
+        if (measured) {
+            num_executions[ParticleBackend::eStageEmit] += emit;
+            num_executions[ParticleBackend::eStageUpdate] += 1;
+            for (uint32_t stage = ParticleBackend::eStageScan1; stage <= ParticleBackend::eStageCompact; stage++) {
+                num_executions[stage] += compact;
+            }
+            sum_num_particles += backend.num_particles();
+            if (null_gl) {
+                auto prev_time = frame_begin_time;
+                for (const auto &call : null_gl_calls()) {
+                    num_gl_calls[call.function]++;
+                    std::chrono::duration<double, std::nano> elapsed = call.time - prev_time;
+                    gl_call_ns[call.function] += elapsed.count();
+                    prev_time = call.time;
+                }
+            }
+        }
+    }
+    backend.finish();
+
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin_time;
+    result.frame_ms = elapsed.count() / num_frames;
+    result.avg_num_particles = sum_num_particles / num_frames;
+
+    for (uint32_t function = 0; function < eNumNullGlFunctions; function++) {
+        if (num_gl_calls[function] == 0) {
+            continue;
+        }
+        result.gl_calls.push_back({
+            .function = null_gl_function_name(static_cast<NullGlFunction>(function)),
+            .calls_per_frame = static_cast<double>(num_gl_calls[function]) / num_frames,
+            .ns_per_frame = gl_call_ns[function] / num_frames,
+        });
+    }
+    if (!result.gl_calls.empty()) {
+        // null OpenGL doesn't time GPU stages
+        result.backend += "_null_gl";
+        return result;
+    }
+
+    for (uint32_t stage = 0; stage < ParticleBackend::eNumStages; stage++) {
+        // GPU times not available in time may have been dropped, so the average of those read is used
+        auto time = backend.stage_stats(stage).time;
+        auto total_ms = time.total_ms - warmup_stats[stage].time.total_ms;
+        auto total_count = time.total_count - warmup_stats[stage].time.total_count;
+        auto &result_stage = result.stages[stage];
+        result_stage.used = total_count > 0;
+        if (!result_stage.used) {
+            continue;
+        }
+        result_stage.ms_per_frame = total_ms / total_count * num_executions[stage] / num_frames;
+        if (result.avg_num_particles > 0.0) {
+            result_stage.ns_per_particle = result_stage.ms_per_frame * 1e6 / result.avg_num_particles;
+        }
+    }
+
+    return result;
+}
+
+void write_bench_json(std::ostream &out, const std::vector<BenchResult> &results) {
+    out << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &result = results[i];
+        out << (i > 0 ? "," : "") << "\n    {\n";
+        out << "      \"scenario\": \"" << result.scenario << "\",\n";
+        out << "      \"backend\": \"" << result.backend << "\",\n";
+        out << "      \"frames\": " << result.num_frames << ",\n";
+        out << "      \"avg_particles\": " << result.avg_num_particles << ",\n";
+        out << "      \"frame_ms\": " << result.frame_ms << ",\n";
+        out << "      \"stages\": {";
+        bool first = true;
+        for (uint32_t stage = 0; stage < ParticleBackend::eNumStages; stage++) {
+            const auto &result_stage = result.stages[stage];
+            if (!result_stage.used) {
+                continue;
+            }
+            out << (first ? "" : ",") << "\n        \"" << ParticleBackend::stage_name(stage) << "\": { ";
+            out << "\"ms_per_frame\": " << result_stage.ms_per_frame << ", ";
+            out << "\"ns_per_particle_frame\": " << result_stage.ns_per_particle << " }";
+            first = false;
+        }
+        out << "\n      }";
+        if (!result.gl_calls.empty()) {
+            out << ",\n      \"gl_calls\": {";
+            for (size_t j = 0; j < result.gl_calls.size(); j++) {
+                const auto &calls = result.gl_calls[j];
+                out << (j > 0 ? "," : "") << "\n        \"" << calls.function << "\": { ";
+                out << "\"calls_per_frame\": " << calls.calls_per_frame << ", ";
+                out << "\"ns_per_frame\": " << calls.ns_per_frame << " }";
+            }
+            out << "\n      }";
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void write_bench_csv(std::ostream &out, const std::vector<BenchResult> &results) {
+    out << "scenario,backend,stage,frames,avg_particles,ms_per_frame,ns_per_particle_frame,calls_per_frame\n";
+    for (const auto &result : results) {
+        auto write_row = [&](const char *stage, double ms_per_frame) {
+            auto ns_per_particle = result.avg_num_particles > 0.0 ? ms_per_frame * 1e6 / result.avg_num_particles : 0.0;
+            out << result.scenario << "," << result.backend << "," << stage << "," << result.num_frames << ","
+                << result.avg_num_particles << "," << ms_per_frame << "," << ns_per_particle << ",\n";
+        };
+        for (uint32_t stage = 0; stage < ParticleBackend::eNumStages; stage++) {
+            if (result.stages[stage].used) {
+                write_row(ParticleBackend::stage_name(stage), result.stages[stage].ms_per_frame);
+            }
+        }
+        write_row("frame", result.frame_ms);
+        for (const auto &calls : result.gl_calls) {
+            out << result.scenario << "," << result.backend << "," << calls.function << "," << result.num_frames
+                << "," << result.avg_num_particles << "," << calls.ns_per_frame * 1e-6 << ",," << calls.calls_per_frame
+                << "\n";
+        }
+    }
+}
+
+ValidationResult validate_backends(
+    ParticleBackend &reference, ParticleBackend &tested, const BenchScenario &scenario, uint32_t num_frames,
+    uint32_t interval, GlUploadRing *upload_ring, const ParticleTolerances &tolerances
+) {
+    ValidationResult result;
+    result.scenario = scenario.name;
+    result.backends[0] = reference.name();
+    result.backends[1] = tested.name();
+
+    reference.reset();
+    tested.reset();
+
+    std::vector<Particle> particles[2];
+    for (uint32_t frame = 0; frame < num_frames; frame++) {
+        if (upload_ring) {
+            upload_ring->begin_frame();
+        }
+        bool emit;
+        bool compact;
+        run_frame(reference, scenario, frame, emit, compact);
+        run_frame(tested, scenario, frame, emit, compact);
+        if (upload_ring) {
+            upload_ring->end_frame();
+        }
+        result.num_frames = frame + 1;
+
+        if ((frame + 1) % interval == 0 || frame + 1 == num_frames) {
+            reference.read_particles(particles[0]);
+            tested.read_particles(particles[1]);
+            result.diff = diff_particles(particles[0], particles[1], tolerances);
+            if (!result.diff.passed()) {
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+void write_validation_report(std::ostream &out, const ValidationResult &result) {
+    const auto &diff = result.diff;
+    out << result.scenario << ": " << result.backends[1] << " against " << result.backends[0] << ", "
+        << (diff.passed() ? "passed" : "FAILED") << " after " << result.num_frames << " frames\n";
+    out << "  particles: " << diff.num_particles[0] << " " << result.backends[0] << ", "
+        << diff.num_particles[1] << " " << result.backends[1] << "\n";
+    for (uint32_t index = 0; index < kNumParticleFloats; index++) {
+        out << "  " << particle_float_name(index) << ": max " << diff.max_ulps[index] << " ulps, "
+            << diff.max_abs[index] << " absolute\n";
+    }
+    if (diff.diverged) {
+        // enough digits to tell floats apart
+        auto precision = out.precision(std::numeric_limits<float>::max_digits10);
+        out << "  first diverging particle " << diff.first_diverging << ", at "
+            << particle_float_name(diff.first_diverging_float) << "\n";
+        for (uint32_t backend = 0; backend < 2; backend++) {
+            const auto &part = diff.first_diverging_particles[backend];
+            out << "    " << result.backends[backend] << ": position (" << part.position.x << ", "
+                << part.position.y << ", " << part.position.z << "), velocity (" << part.velocity.x << ", "
+                << part.velocity.y << ", " << part.velocity.z << "), acceleration (" << part.acceleration.x << ", "
+                << part.acceleration.y << ", " << part.acceleration.z << "), mass " << part.mass << ", life "
+                << part.life << ", size " << part.size << "\n";
+        }
+        out.precision(precision);
+    }
+}
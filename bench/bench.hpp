@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "particles/particle_backend.hpp"
+#include "particles/particle_diff.hpp"
+
+class GlUploadRing;
+
+// Workload of the benchmark, driven like 'ParticleSystem::update' without drawing.
+struct BenchScenario {
+    const char *name;
+    const char *description;
+    // 'count' and 'seed' are set by every emission
+    ParticleEmitParams emit;
+    uint32_t emit_count;
+    uint32_t emit_interval;
+    uint32_t compact_interval;
+    ParticleUpdateParams update;
+};
+
+// steady state, burst emission, short-life churn, and steady state compacted every 'compact_interval' frames
+std::vector<BenchScenario> bench_scenarios(uint32_t compact_interval);
+
+struct BenchResult {
+    std::string scenario;
+    std::string backend;
+    uint32_t num_frames = 0;
+    // at the end of measured frames, on average
+    double avg_num_particles = 0.0;
+    // CPU time of a frame, including the submission of GPU work and waiting for it at the end
+    double frame_ms = 0.0;
+    struct Stage {
+        // whether the backend timed the stage
+        bool used = false;
+        // time of all executions spread over every frame, and per particle
+        double ms_per_frame = 0.0;
+        double ns_per_particle = 0.0;
+    };
+    Stage stages[ParticleBackend::eNumStages];
+    // recorded on null OpenGL, see 'null_gl.hpp', for each function called
+    struct GlCalls {
+        const char *function;
+        double calls_per_frame = 0.0;
+        // time since the previous recorded call, or the beginning of the frame, spent issuing this one
+        double ns_per_frame = 0.0;
+    };
+    std::vector<GlCalls> gl_calls;
+};
+
+// runs 'num_warmup_frames' frames, and measures the next 'num_frames' ones,
+// 'upload_ring' is begun and ended around every frame if given, as the GPU backend needs it.
+// On null OpenGL, GL calls are measured instead of GPU stage times.
+BenchResult run_bench(
+    ParticleBackend &backend, const BenchScenario &scenario, uint32_t num_warmup_frames, uint32_t num_frames,
+    GlUploadRing *upload_ring
+);
+
+void write_bench_json(std::ostream &out, const std::vector<BenchResult> &results);
+// one row per stage, a 'frame' row with the CPU time of frames, and one row per recorded GL function
+void write_bench_csv(std::ostream &out, const std::vector<BenchResult> &results);
+
+struct ValidationResult {
+    std::string scenario;
+    std::string backends[2];
+    // frames run, up to the first one where particles diverged
+    uint32_t num_frames = 0;
+    // of the last comparison
+    ParticleDiff diff;
+};
+
+// runs both backends on the same input for up to 'num_frames' frames, comparing their particles every
+// 'interval' frames and after the last one, and stops at the first mismatch
+ValidationResult validate_backends(
+    ParticleBackend &reference, ParticleBackend &tested, const BenchScenario &scenario, uint32_t num_frames,
+    uint32_t interval, GlUploadRing *upload_ring, const ParticleTolerances &tolerances
+);
+
+void write_validation_report(std::ostream &out, const ValidationResult &result);
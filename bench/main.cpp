@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glfw/glfw3.h>
+#if BENCH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "bench.hpp"
+#include "glh/null_gl.hpp"
+#include "glh/resource.hpp"
+#include "particles/cpu_particle_backend.hpp"
+#include "particles/gpu_particle_backend.hpp"
+
+namespace {
+
+constexpr uint64_t kUploadRingFrameSize = 64 * 1024;
+constexpr uint32_t kMaxNumParticles = 4 * 1024 * 1024;
+// exit code of '--validate' without OpenGL 4.6, which CTest reports as skipped, see 'CMakeLists.txt'
+constexpr int kSkipExitCode = 77;
+
+const char *kUsage = R"(usage: particles_bench [options]
+  --backend cpu|gpu|all       backends to run, all by default
+  --scenario <name>|all       scenarios to run, all by default: steady, burst, churn, compact_interval
+  --frames <n>                measured frames of each scenario, 600 by default
+  --warmup <n>                frames run before measuring, 240 by default
+  --compact-interval <n>      frames between compactions of 'compact_interval', 8 by default
+  --substeps <n>              substeps of every update, each one a fraction of the frame time, 1 by default
+  --threads <n>               threads of the CPU backend, one per hardware thread by default
+  --isa <name>                instruction set of the CPU backend, the best supported one by default
+  --format json|csv           json by default
+  --output <file>             standard output by default
+  --validate                  instead of measuring, run the CPU backend against the GPU one for '--frames' frames
+                              of each scenario, and report the first particle out of tolerance, see 'particle_diff.hpp'.
+                              Exits with 77 when no OpenGL 4.6 context can be created
+  --validate-interval <n>     frames between comparisons when validating, 1 by default
+  --null-gl                   run the GPU backend on OpenGL stubs instead of a driver, and report calls and CPU time
+                              per frame of functions which bind and submit work, see 'null_gl.hpp'
+)";
+
+// OpenGL 4.6 context for the GPU backend, without display where EGL has the surfaceless platform of Mesa,
+// otherwise of a hidden window
+class HeadlessContext {
+public:
+    HeadlessContext() {
+#if BENCH_EGL
+        if (create_surfaceless_context()) {
+            valid_ = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)) != 0;
+            return;
+        }
+#endif
+        if (!glfwInit()) {
+            return;
+        }
+        glfw_initialized_ = true;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window_ = glfwCreateWindow(64, 64, "particles_bench", nullptr, nullptr);
+        if (window_ == nullptr) {
+            return;
+        }
+        glfwMakeContextCurrent(window_);
+        valid_ = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)) != 0;
+    }
+    ~HeadlessContext() {
+#if BENCH_EGL
+        if (egl_context_ != EGL_NO_CONTEXT) {
+            eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(egl_display_, egl_context_);
+        }
+        if (egl_display_ != EGL_NO_DISPLAY) {
+            eglTerminate(egl_display_);
+        }
+#endif
+        if (window_) {
+            glfwDestroyWindow(window_);
+        }
+        if (glfw_initialized_) {
+            glfwTerminate();
+        }
+    }
+
+    bool valid() const { return valid_; }
+
+private:
+#if BENCH_EGL
+    // needs EGL_MESA_platform_surfaceless, EGL_KHR_surfaceless_context and EGL_KHR_no_config_context
+    bool create_surfaceless_context() {
+        auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT")
+        );
+        if (get_platform_display == nullptr) {
+            return false;
+        }
+        egl_display_ = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (egl_display_ == EGL_NO_DISPLAY) {
+            return false;
+        }
+        if (!eglInitialize(egl_display_, nullptr, nullptr)) {
+            egl_display_ = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            return false;
+        }
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 6,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+        egl_context_ = eglCreateContext(egl_display_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (egl_context_ == EGL_NO_CONTEXT) {
+            return false;
+        }
+        return eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context_) == EGL_TRUE;
+    }
+
+    EGLDisplay egl_display_ = EGL_NO_DISPLAY;
+    EGLContext egl_context_ = EGL_NO_CONTEXT;
+#endif
+    bool glfw_initialized_ = false;
+    GLFWwindow *window_ = nullptr;
+    bool valid_ = false;
+};
+
+bool setup_cpu_backend(CpuParticleBackend &backend, uint32_t num_threads, const std::string &isa_name) {
+    backend.set_num_threads(num_threads);
+    if (!isa_name.empty()) {
+        uint32_t isa = 0;
+        while (isa < eNumIsas && isa_name != cpu_isa_name(static_cast<CpuIsa>(isa))) {
+            isa++;
+        }
+        if (isa > detect_cpu_isa()) {
+            std::cerr << "instruction set " << isa_name << " isn't supported\n";
+            return false;
+        }
+        backend.set_isa(static_cast<CpuIsa>(isa));
+    }
+    std::cerr << "cpu: " << cpu_isa_name(backend.isa()) << ", threads: " << backend.num_threads() << "\n";
+    return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string backend_name = "all";
+    std::string scenario_name = "all";
+    uint32_t num_frames = 600;
+    uint32_t num_warmup_frames = 240;
+    uint32_t compact_interval = 8;
+    uint32_t num_substeps = 1;
+    uint32_t num_threads = 0;
+    std::string isa_name;
+    std::string format = "json";
+    std::string output;
+    bool validate = false;
+    uint32_t validate_interval = 1;
+    bool null_gl = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << kUsage;
+            return 0;
+        }
+        if (arg == "--validate") {
+            validate = true;
+            continue;
+        }
+        if (arg == "--null-gl") {
+            null_gl = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value of " << arg << "\n" << kUsage;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--backend") {
+            backend_name = value;
+        } else if (arg == "--scenario") {
+            scenario_name = value;
+        } else if (arg == "--frames") {
+            num_frames = std::max(std::stoul(value), 1ul);
+        } else if (arg == "--warmup") {
+            num_warmup_frames = std::stoul(value);
+        } else if (arg == "--compact-interval") {
+            compact_interval = std::max(std::stoul(value), 1ul);
+        } else if (arg == "--substeps") {
+            num_substeps = std::max(std::stoul(value), 1ul);
+        } else if (arg == "--threads") {
+            num_threads = std::stoul(value);
+        } else if (arg == "--isa") {
+            isa_name = value;
+        } else if (arg == "--format") {
+            format = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else if (arg == "--validate-interval") {
+            validate_interval = std::max(std::stoul(value), 1ul);
+        } else {
+            std::cerr << "unknown option " << arg << "\n" << kUsage;
+            return 1;
+        }
+    }
+    if (backend_name != "all" && backend_name != "cpu" && backend_name != "gpu") {
+        std::cerr << "unknown backend " << backend_name << "\n";
+        return 1;
+    }
+    if (format != "json" && format != "csv") {
+        std::cerr << "unknown format " << format << "\n";
+        return 1;
+    }
+
+    std::vector<BenchScenario> scenarios;
+    for (const auto &scenario : bench_scenarios(compact_interval)) {
+        if (scenario_name == "all" || scenario_name == scenario.name) {
+            scenarios.push_back(scenario);
+            scenarios.back().update.num_substeps = num_substeps;
+            scenarios.back().update.delta_time /= num_substeps;
+        }
+    }
+    if (scenarios.empty()) {
+        std::cerr << "unknown scenario " << scenario_name << "\n";
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file) {
+            std::cerr << "failed to open " << output << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = output.empty() ? std::cout : file;
+
+    if (validate) {
+        HeadlessContext context;
+        if (!context.valid()) {
+            std::cerr << "failed to create an OpenGL 4.6 context, which validation needs, it's skipped\n";
+            return kSkipExitCode;
+        }
+        std::cerr << "gpu: " << glGetString(GL_RENDERER) << "\n";
+        GlUploadRing upload_ring(kUploadRingFrameSize);
+        GpuParticleBackend gpu_backend(upload_ring, kMaxNumParticles);
+        CpuParticleBackend cpu_backend(kMaxNumParticles);
+        if (!setup_cpu_backend(cpu_backend, num_threads, isa_name)) {
+            return 1;
+        }
+        bool passed = true;
+        for (const auto &scenario : scenarios) {
+            auto result = validate_backends(
+                gpu_backend, cpu_backend, scenario, num_frames, validate_interval, &upload_ring, {}
+            );
+            write_validation_report(out, result);
+            passed = passed && result.diff.passed();
+        }
+        return passed ? 0 : 1;
+    }
+
+    std::vector<BenchResult> results;
+
+    if (backend_name == "all" || backend_name == "cpu") {
+        CpuParticleBackend backend(kMaxNumParticles);
+        if (!setup_cpu_backend(backend, num_threads, isa_name)) {
+            return 1;
+        }
+        for (const auto &scenario : scenarios) {
+            results.push_back(run_bench(backend, scenario, num_warmup_frames, num_frames, nullptr));
+        }
+    }
+
+    if (backend_name == "all" || backend_name == "gpu") {
+        // null OpenGL needs no context
+        std::unique_ptr<HeadlessContext> context;
+        bool loaded = false;
+        if (null_gl) {
+            loaded = load_null_gl();
+        } else {
+            context = std::make_unique<HeadlessContext>();
+            loaded = context->valid();
+        }
+        if (!loaded) {
+            std::cerr << "failed to load OpenGL 4.6, the GPU backend is skipped\n";
+            if (backend_name == "gpu") {
+                return 1;
+            }
+        } else {
+            std::cerr << "gpu: " << glGetString(GL_RENDERER) << "\n";
+            GlUploadRing upload_ring(kUploadRingFrameSize);
+            GpuParticleBackend backend(upload_ring, kMaxNumParticles);
+            for (const auto &scenario : scenarios) {
+                results.push_back(run_bench(backend, scenario, num_warmup_frames, num_frames, &upload_ring));
+            }
+        }
+    }
+
+    if (format == "json") {
+        write_bench_json(out, results);
+    } else {
+        write_bench_csv(out, results);
+    }
+
+    return 0;
+}
@@ -6,8 +6,12 @@ layout(location = 2) in vec2 a_uv;
 
 layout(location = 0) out vec4 frag_color;
 
+// same as 'draw.vert'
 layout(binding = 2) uniform RenderParams {
     vec4 color;
+    float viewport_height;
+    uint billboard_num_indices;
+    vec4 billboard_corners[8];
 } params;
 
 layout(binding = 3) uniform sampler2D particle_tex;
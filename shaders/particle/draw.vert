@@ -4,12 +4,35 @@
 
 #include "particle.glsl"
 
+// particles are drawn in the order of an index list, the alive list or particles sorted by depth
+layout(constant_id = 0) const bool kUseIndices = false;
+// one instance of the indexed corners of a billboard per particle, or a single instance where the vertices of
+// each particle are pulled from gl_VertexID, which fills vertex wavefronts better on some GPUs
+layout(constant_id = 1) const bool kPullVertices = false;
+
+// must match 'kMaxBillboardCorners' in 'particle_system.cpp'
+#define MAX_BILLBOARD_CORNERS 8
+
 layout(location = 0) out vec3 a_pos;
 layout(location = 1) out vec3 a_norm;
 layout(location = 2) out vec2 a_uv;
 
+#ifdef PARTICLE_SOA
+layout(binding = PARTICLE_STREAM_BINDING + STREAM_POSITION_SIZE) buffer readonly PositionSize {
+    vec4 position_size[];
+};
+
+layout(binding = PARTICLE_STREAM_BINDING + STREAM_LIFE) buffer readonly Life {
+    float lives[];
+};
+#else
 layout(binding = 0) buffer readonly Particles {
-    Particle particles[];
+    ParticleData particles[];
+};
+#endif
+
+layout(binding = 1) buffer readonly DrawIndices {
+    uint draw_indices[];
 };
 
 layout(binding = 1) uniform Camera {
@@ -18,8 +41,32 @@ layout(binding = 1) uniform Camera {
     mat4 view_inv;
 } cam;
 
+// billboards are a convex polygon in texture coordinates, the quad or fitted to the alpha of the texture,
+// drawn as a fan of triangles around corner 0, same as the index buffer of instanced draws
+layout(binding = 2) uniform RenderParams {
+    vec4 color;
+    float viewport_height;
+    uint billboard_num_indices;
+    vec4 billboard_corners[MAX_BILLBOARD_CORNERS];
+} params;
+
 void main() {
-    Particle part = particles[gl_InstanceID];
+    uint instance = kPullVertices ? gl_VertexID / params.billboard_num_indices : gl_InstanceID;
+    uint corner = gl_VertexID;
+    if (kPullVertices) {
+        // index 'i' of the fan is 0, 't + 1' or 't + 2' of triangle 't = i / 3'
+        uint i = gl_VertexID % params.billboard_num_indices;
+        corner = i % 3 == 0 ? 0 : i / 3 + i % 3;
+    }
+    uint index = kUseIndices ? draw_indices[instance] : instance;
+#ifdef PARTICLE_SOA
+    Particle part;
+    part.position = position_size[index].xyz;
+    part.size = position_size[index].w;
+    part.life = lives[index];
+#else
+    Particle part = unpack_particle(particles[index]);
+#endif
     float size = part.size * clamp(part.life, 0.0, 1.0);
 
     vec3 cam_pos = cam.view_inv[3].xyz;
@@ -28,21 +75,9 @@ void main() {
     vec3 forward = normalize(part.position - cam_pos);
     vec3 right = cross(forward, cam_up);
 
-    vec3 pos_world;
-    vec2 uv;
-    if (gl_VertexID == 0) {
-        pos_world = part.position - right * size - cam_up * size;
-        uv = vec2(0.0, 0.0);
-    } else if (gl_VertexID == 1) {
-        pos_world = part.position + right * size - cam_up * size;
-        uv = vec2(1.0, 0.0);
-    } else if (gl_VertexID == 2) {
-        pos_world = part.position + right * size + cam_up * size;
-        uv = vec2(1.0, 1.0);
-    } else { // if (gl_VertexID == 3) {
-        pos_world = part.position - right * size + cam_up * size;
-        uv = vec2(0.0, 1.0);
-    }
+    vec2 uv = params.billboard_corners[corner].xy;
+    vec2 offset = uv * 2.0 - 1.0;
+    vec3 pos_world = part.position + right * (size * offset.x) + cam_up * (size * offset.y);
 
     gl_Position = cam.proj * cam.view * vec4(pos_world, 1.0);
     a_pos = pos_world;
@@ -0,0 +1,18 @@
+#version 460
+
+layout(location = 0) in float a_coverage;
+
+layout(location = 0) out vec4 frag_color;
+
+layout(binding = 2) uniform RenderParams {
+    vec4 color;
+    float viewport_height;
+} params;
+
+layout(binding = 3) uniform sampler2D particle_tex;
+
+void main() {
+    // the last mip level is the average of the billboard texture
+    vec4 color = textureLod(particle_tex, vec2(0.5), 16.0) * params.color;
+    frag_color = vec4(color.rgb, color.a * a_coverage);
+}
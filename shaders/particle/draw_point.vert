@@ -0,0 +1,57 @@
+#version 460
+
+#extension GL_GOOGLE_include_directive : enable
+
+#include "particle.glsl"
+
+// particles smaller than a pixel, as classified by 'cull.comp', drawn as one point each
+layout(location = 0) out float a_coverage;
+
+#ifdef PARTICLE_SOA
+layout(binding = PARTICLE_STREAM_BINDING + STREAM_POSITION_SIZE) buffer readonly PositionSize {
+    vec4 position_size[];
+};
+
+layout(binding = PARTICLE_STREAM_BINDING + STREAM_LIFE) buffer readonly Life {
+    float lives[];
+};
+#else
+layout(binding = 0) buffer readonly Particles {
+    ParticleData particles[];
+};
+#endif
+
+layout(binding = 1) buffer readonly PointIndices {
+    uint point_indices[];
+};
+
+layout(binding = 1) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 view_inv;
+} cam;
+
+layout(binding = 2) uniform RenderParams {
+    vec4 color;
+    float viewport_height;
+} params;
+
+void main() {
+    uint index = point_indices[gl_VertexID];
+#ifdef PARTICLE_SOA
+    Particle part;
+    part.position = position_size[index].xyz;
+    part.size = position_size[index].w;
+    part.life = lives[index];
+#else
+    Particle part = unpack_particle(particles[index]);
+#endif
+    float size = part.size * clamp(part.life, 0.0, 1.0);
+
+    vec4 pos_view = cam.view * vec4(part.position, 1.0);
+    gl_Position = cam.proj * pos_view;
+
+    // fraction of the pixel which the billboard would cover
+    float pixel_size = size * cam.proj[1][1] * params.viewport_height / -pos_view.z;
+    a_coverage = min(pixel_size * pixel_size, 1.0);
+}
@@ -1,6 +1,7 @@
 #ifndef PARTICLE_GLSL_
 #define PARTICLE_GLSL_
 
+// particle as seen by kernels, stored as 'ParticleData', must match 'Particle' in 'particle_backend.hpp'
 struct Particle {
     vec3 position;
     float mass;
@@ -10,4 +11,90 @@ struct Particle {
     float size;
 };
 
+#ifdef PARTICLE_SOA
+
+// Structure of arrays, one buffer per stream, so that each kernel only binds the streams it touches.
+// Streams of the particle array are bound from PARTICLE_STREAM_BINDING, those of the compacted array
+// from PARTICLE_NEW_STREAM_BINDING. Must match 'ParticleStream' in 'gpu_particle_backend.cpp'.
+#define PARTICLE_STREAM_BINDING 16
+#define PARTICLE_NEW_STREAM_BINDING 20
+// vec4, position and size
+#define STREAM_POSITION_SIZE 0
+// vec4, velocity and mass
+#define STREAM_VELOCITY_MASS 1
+// vec4, acceleration and unused w
+#define STREAM_ACCELERATION 2
+// float
+#define STREAM_LIFE 3
+
+#endif
+
+#ifdef PARTICLE_PACKED
+
+// life is stored normalized to this range, in seconds, must match 'kPackedLifeRange' in 'gpu_particle_backend.hpp'
+#define PACKED_LIFE_RANGE 64.0
+#define PACKED_LIFE_STEP (PACKED_LIFE_RANGE / 65535.0)
+
+// 24 bytes, only scalar members so that array stride isn't rounded up to 16 bytes.
+// Acceleration isn't stored, 'update.comp' uses an integrator that doesn't need it.
+// Must match 'PackedParticle' in 'gpu_particle_backend.cpp'.
+struct ParticleData {
+    float position_x;
+    float position_y;
+    float position_z;
+    // half floats
+    uint velocity_xy;
+    uint velocity_z_mass;
+    // half float size in low bits, unorm16 life in high bits
+    uint size_life;
+};
+
+ParticleData pack_particle(Particle part) {
+    uint life = uint(round(clamp(part.life / PACKED_LIFE_RANGE, 0.0, 1.0) * 65535.0));
+
+    ParticleData data;
+    data.position_x = part.position.x;
+    data.position_y = part.position.y;
+    data.position_z = part.position.z;
+    data.velocity_xy = packHalf2x16(part.velocity.xy);
+    data.velocity_z_mass = packHalf2x16(vec2(part.velocity.z, part.mass));
+    data.size_life = (packHalf2x16(vec2(part.size, 0.0)) & 0xffffu) | (life << 16);
+    return data;
+}
+
+float particle_life(ParticleData data) {
+    return float(data.size_life >> 16) / 65535.0 * PACKED_LIFE_RANGE;
+}
+
+Particle unpack_particle(ParticleData data) {
+    vec2 velocity_z_mass = unpackHalf2x16(data.velocity_z_mass);
+
+    Particle part;
+    part.position = vec3(data.position_x, data.position_y, data.position_z);
+    part.velocity = vec3(unpackHalf2x16(data.velocity_xy), velocity_z_mass.x);
+    part.mass = velocity_z_mass.y;
+    part.acceleration = vec3(0.0);
+    part.size = unpackHalf2x16(data.size_life).x;
+    part.life = particle_life(data);
+    return part;
+}
+
+#else
+
+#define ParticleData Particle
+
+ParticleData pack_particle(Particle part) {
+    return part;
+}
+
+float particle_life(ParticleData data) {
+    return data.life;
+}
+
+Particle unpack_particle(ParticleData data) {
+    return data;
+}
+
+#endif
+
 #endif
@@ -0,0 +1,99 @@
+#ifndef PARTICLE_SCAN_GLSL_
+#define PARTICLE_SCAN_GLSL_
+
+// Workgroup-wide inclusive scans over SCAN_WIDTH invocations, must be called once in uniform control flow.
+// When SCAN_SUBGROUP is defined (see CMakeLists.txt), subgroup operations are used within each subgroup
+// and only the per-subgroup sums go through shared memory. Otherwise, a work-efficient Blelloch scan is used.
+
+#define SCAN_WIDTH 512
+
+#ifdef SCAN_SUBGROUP
+
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+
+shared uint scan_sdata[SCAN_WIDTH];
+
+// Subgroups are assumed to cover consecutive local invocation indices, which holds for 1D workgroups in practice.
+// 'sum' is the inclusive scan within the subgroup
+uint scan_subgroup_sums(uint sum) {
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1) {
+        scan_sdata[gl_SubgroupID] = sum;
+    }
+    barrier();
+
+    // there can be more subgroups than invocations in a subgroup, so scan them in chunks
+    if (gl_SubgroupID == 0) {
+        uint carry = 0;
+        for (uint base = 0; base < gl_NumSubgroups; base += gl_SubgroupSize) {
+            uint index = base + gl_SubgroupInvocationID;
+            uint value = index < gl_NumSubgroups ? scan_sdata[index] : 0;
+            uint subgroup_sum = subgroupInclusiveAdd(value);
+            if (index < gl_NumSubgroups) {
+                scan_sdata[index] = carry + subgroup_sum;
+            }
+            carry += subgroupAdd(value);
+        }
+    }
+    barrier();
+
+    return gl_SubgroupID == 0 ? sum : sum + scan_sdata[gl_SubgroupID - 1];
+}
+
+uint workgroup_inclusive_scan(uint value) {
+    return scan_subgroup_sums(subgroupInclusiveAdd(value));
+}
+
+uint workgroup_inclusive_count(bool flag) {
+    return scan_subgroup_sums(subgroupBallotInclusiveBitCount(subgroupBallot(flag)));
+}
+
+#else
+
+shared uint scan_sdata[SCAN_WIDTH];
+
+uint workgroup_inclusive_scan(uint value) {
+    uint local_index = gl_LocalInvocationID.x;
+    scan_sdata[local_index] = value;
+
+    // up-sweep
+    uint offset = 1;
+    for (uint d = SCAN_WIDTH >> 1; d > 0; d >>= 1) {
+        barrier();
+        if (local_index < d) {
+            uint ai = offset * (2 * local_index + 1) - 1;
+            uint bi = offset * (2 * local_index + 2) - 1;
+            scan_sdata[bi] += scan_sdata[ai];
+        }
+        offset <<= 1;
+    }
+
+    barrier();
+    if (local_index == 0) {
+        scan_sdata[SCAN_WIDTH - 1] = 0;
+    }
+
+    // down-sweep
+    for (uint d = 1; d < SCAN_WIDTH; d <<= 1) {
+        offset >>= 1;
+        barrier();
+        if (local_index < d) {
+            uint ai = offset * (2 * local_index + 1) - 1;
+            uint bi = offset * (2 * local_index + 2) - 1;
+            uint temp = scan_sdata[ai];
+            scan_sdata[ai] = scan_sdata[bi];
+            scan_sdata[bi] += temp;
+        }
+    }
+    barrier();
+
+    return scan_sdata[local_index] + value;
+}
+
+uint workgroup_inclusive_count(bool flag) {
+    return workgroup_inclusive_scan(flag ? 1 : 0);
+}
+
+#endif
+
+#endif
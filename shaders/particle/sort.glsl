@@ -0,0 +1,43 @@
+#ifndef PARTICLE_SORT_GLSL_
+#define PARTICLE_SORT_GLSL_
+
+#include "state.glsl"
+
+// Least significant digit radix sort of (key, value) pairs, 4 bits per pass.
+// Each pass counts digits of every block of keys ('sort_count.comp'), scans the counts in digit-major order
+// ('sort_scan.comp'), and sorts each block by the digit in shared memory before scattering it ('sort_scatter.comp').
+
+// must match 'kSortKeyBits' in 'gpu_particle_backend.cpp'
+#define SORT_KEY_BITS 24
+#define SORT_RADIX_BITS 4
+#define SORT_RADIX 16
+// invocations of 'sort_count.comp' and 'sort_scatter.comp', same as SCAN_WIDTH
+#define SORT_WORKGROUP_SIZE 512
+#define SORT_KEYS_PER_INVOCATION 4
+#define SORT_BLOCK_SIZE (SORT_WORKGROUP_SIZE * SORT_KEYS_PER_INVOCATION)
+
+// written by 'sort_keys.comp', must match 'SortState' in 'gpu_particle_backend.cpp'
+struct SortState {
+    uint num_keys;
+    uint num_blocks;
+    DispatchIndirectCommand block_dispatch;
+};
+
+SortState make_sort_state(uint num_keys) {
+    uint num_blocks = (num_keys + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+    return SortState(num_keys, num_blocks, DispatchIndirectCommand(num_blocks, 1, 1));
+}
+
+// increasing keys go from the farthest depth to the nearest one, the lowest bits of the mantissa are dropped
+uint depth_sort_key(float depth) {
+    uint bits = floatBitsToUint(depth);
+    // floats ordered as unsigned integers: all bits of negative ones are flipped, only the sign of positive ones
+    uint ordered = (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+    return ~ordered >> (32 - SORT_KEY_BITS);
+}
+
+uint sort_digit(uint key, uint shift) {
+    return (key >> shift) & (SORT_RADIX - 1);
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PARTICLE_STATE_GLSL_
+#define PARTICLE_STATE_GLSL_
+
+// 512^4 blocks cover any 32-bit particle count
+#define MAX_SCAN_LEVELS 4
+
+struct DispatchIndirectCommand {
+    uint num_groups_x;
+    uint num_groups_y;
+    uint num_groups_z;
+};
+
+struct DrawElementsIndirectCommand {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+struct DrawArraysIndirectCommand {
+    uint count;
+    uint instance_count;
+    uint first;
+    uint base_instance;
+};
+
+// Number of particles lives on GPU only, together with indirect dispatch arguments derived from it.
+// In dead list mode, 'num_particles' is the length of the alive list.
+// Must match 'ParticleState' in 'gpu_particle_backend.cpp'.
+struct ParticleState {
+    uint num_particles;
+    uint emit_offset;
+    uint emit_count;
+    uint emit_dead_offset;
+    DispatchIndirectCommand emit_dispatch;
+    DispatchIndirectCommand update_dispatch;
+    // per level of the scan hierarchy, level 0 scans the particles themselves
+    DispatchIndirectCommand scan_dispatch[MAX_SCAN_LEVELS];
+    DispatchIndirectCommand scan3_dispatch[MAX_SCAN_LEVELS];
+};
+
+// arguments of the draws of a frame, derived from the drawn counts by 'draw_args.comp'.
+// Must match 'DrawArgs' in 'gpu_particle_backend.cpp'.
+struct DrawArgs {
+    // one instance of the indices of a billboard per particle
+    DrawElementsIndirectCommand billboard_draw;
+    // every billboard in a single instance, vertices are pulled by 'draw.vert' from gl_VertexID
+    DrawArraysIndirectCommand pulled_draw;
+    // one point per particle, see 'draw_point.vert'
+    DrawArraysIndirectCommand point_draw;
+};
+
+DispatchIndirectCommand make_dispatch(uint count, uint group_size) {
+    return DispatchIndirectCommand((count + group_size - 1) / group_size, 1, 1);
+}
+
+void set_num_particles(inout ParticleState state, uint num_particles) {
+    state.num_particles = num_particles;
+    state.update_dispatch = make_dispatch(num_particles, 512);
+
+    // each level scans the block sums of the previous one
+    uint size = num_particles;
+    for (uint level = 0; level < MAX_SCAN_LEVELS; ++level) {
+        uint num_blocks = (size + 511) / 512;
+        state.scan_dispatch[level] = DispatchIndirectCommand(num_blocks, 1, 1);
+        state.scan3_dispatch[level] = DispatchIndirectCommand(max(num_blocks, 1) - 1, 1, 1);
+        size = num_blocks;
+    }
+}
+
+// state of a freshly compacted particle array
+ParticleState make_particle_state(uint num_particles) {
+    ParticleState state;
+    state.emit_offset = 0;
+    state.emit_count = 0;
+    state.emit_dead_offset = 0;
+    state.emit_dispatch = DispatchIndirectCommand(0, 1, 1);
+    set_num_particles(state, num_particles);
+    return state;
+}
+
+#endif
@@ -27,8 +27,6 @@ OrbitCamera::OrbitCamera(const glm::vec3 &look_at, float radius, float aspect) :
     proj_ = glm::perspective(glm::radians(45.0f), aspect, kZNear, kZFar);
     proj_inv_ = glm::inverse(proj_);
     update();
-
-    camera_buffer_ = std::make_unique<GlBuffer>(sizeof(ShaderCamera), GL_MAP_WRITE_BIT);
 }
 
 void OrbitCamera::rotate(float delta_x, float delta_y) {
@@ -59,17 +57,13 @@ void OrbitCamera::update() {
     pos_.z = radius_ * std::sin(phi_) * std::sin(theta_);
     view_ = glm::lookAt(pos_, look_at_, glm::vec3(0.0f, 1.0f, 0.0f));
     view_inv_ = glm::inverse(view_);
-    camera_buffer_dirty_ = true;
 }
 
-const GlBuffer *OrbitCamera::get_buffer() {
-    if (camera_buffer_dirty_) {
-        auto data = camera_buffer_->typed_map<ShaderCamera>(true);
-        data->view = view_;
-        data->view_inv = view_inv_;
-        data->proj = proj_;
-        camera_buffer_->unmap();
-        camera_buffer_dirty_ = false;
-    }
-    return camera_buffer_.get();
+GlBufferRange OrbitCamera::upload(GlUploadRing &upload_ring) const {
+    GlBufferRange range;
+    auto data = upload_ring.typed_allocate<ShaderCamera>(range);
+    data->view = view_;
+    data->view_inv = view_inv_;
+    data->proj = proj_;
+    return range;
 }
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <memory>
-
 #include <glm/glm.hpp>
 
 #include "../glh/resource.hpp"
@@ -21,7 +19,7 @@ public:
 
     void set_aspect(float aspect);
 
-    const GlBuffer *get_buffer();
+    GlBufferRange upload(GlUploadRing &upload_ring) const;
 
 private:
     void update();
@@ -35,7 +33,4 @@ private:
     glm::mat4 proj_inv_;
     glm::mat4 view_;
     glm::mat4 view_inv_;
-
-    std::unique_ptr<GlBuffer> camera_buffer_;
-    bool camera_buffer_dirty_ = true;
 };
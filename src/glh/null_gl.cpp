@@ -0,0 +1,263 @@
+#include "null_gl.hpp"
+
+#include <cstring>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+namespace {
+
+bool loaded = false;
+std::vector<NullGlCall> calls;
+
+// names of every kind of object, never reused
+GLuint next_name = 1;
+
+struct Buffer {
+    uint64_t size = 0;
+    // allocated when the buffer is first mapped
+    std::vector<uint8_t> memory;
+};
+std::unordered_map<GLuint, Buffer> buffers;
+
+void record(NullGlFunction function) {
+    calls.push_back({ function, std::chrono::steady_clock::now() });
+}
+
+void create_names(GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = next_name++;
+    }
+}
+
+void *map_buffer(GLuint buffer, uint64_t offset) {
+    auto &data = buffers[buffer];
+    data.memory.resize(data.size);
+    return data.memory.data() + offset;
+}
+
+void APIENTRY use_program(GLuint) {
+    record(eNullGlUseProgram);
+}
+
+void APIENTRY bind_buffers_base(GLenum, GLuint, GLsizei, const GLuint *) {
+    record(eNullGlBindBuffersBase);
+}
+
+void *APIENTRY map_named_buffer(GLuint buffer, GLenum) {
+    record(eNullGlMapNamedBuffer);
+    return map_buffer(buffer, 0);
+}
+
+void *APIENTRY map_named_buffer_range(GLuint buffer, GLintptr offset, GLsizeiptr, GLbitfield) {
+    record(eNullGlMapNamedBufferRange);
+    return map_buffer(buffer, offset);
+}
+
+void APIENTRY dispatch_compute(GLuint, GLuint, GLuint) {
+    record(eNullGlDispatchCompute);
+}
+
+void APIENTRY dispatch_compute_indirect(GLintptr) {
+    record(eNullGlDispatchComputeIndirect);
+}
+
+void APIENTRY memory_barrier(GLbitfield) {
+    record(eNullGlMemoryBarrier);
+}
+
+const GLubyte *APIENTRY get_string(GLenum name) {
+    const char *str = "null";
+    if (name == GL_VERSION) {
+        // parsed by glad
+        str = "4.6.0 null";
+    } else if (name == GL_SHADING_LANGUAGE_VERSION) {
+        str = "4.60";
+    }
+    return reinterpret_cast<const GLubyte *>(str);
+}
+
+void APIENTRY get_integerv(GLenum name, GLint *data) {
+    if (name == GL_MAJOR_VERSION) {
+        *data = 4;
+    } else if (name == GL_MINOR_VERSION) {
+        *data = 6;
+    } else if (name == GL_NUM_EXTENSIONS) {
+        // glad fails without any extension
+        *data = 1;
+    } else if (name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT) {
+        *data = 256;
+    } else {
+        *data = 0;
+    }
+}
+
+void APIENTRY create_buffers(GLsizei n, GLuint *names) {
+    create_names(n, names);
+}
+
+void APIENTRY delete_buffers(GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) {
+        buffers.erase(names[i]);
+    }
+}
+
+void APIENTRY named_buffer_storage(GLuint buffer, GLsizeiptr size, const void *, GLbitfield) {
+    buffers[buffer].size = size;
+}
+
+void APIENTRY get_named_buffer_sub_data(GLuint, GLintptr, GLsizeiptr size, void *data) {
+    std::memset(data, 0, size);
+}
+
+void APIENTRY get_object_iv(GLuint, GLenum name, GLint *data) {
+    // compilation and linking always succeed
+    *data = name == GL_COMPILE_STATUS || name == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+void APIENTRY get_info_log(GLuint, GLsizei size, GLsizei *length, GLchar *log) {
+    if (length) {
+        *length = 0;
+    }
+    if (size > 0) {
+        log[0] = '\0';
+    }
+}
+
+void APIENTRY get_query_object_iv(GLuint, GLenum name, GLint *data) {
+    *data = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+GLsync APIENTRY fence_sync(GLenum, GLbitfield) {
+    return reinterpret_cast<GLsync>(static_cast<uintptr_t>(next_name++));
+}
+
+struct Proc {
+    const char *name;
+    void *proc;
+};
+
+// checked against the type of the glad function pointer
+#define NULL_GL_PROC(name, stub) { #name, reinterpret_cast<void *>(static_cast<decltype(glad_##name)>(stub)) }
+
+const Proc kProcs[] = {
+    NULL_GL_PROC(glUseProgram, use_program),
+    NULL_GL_PROC(glBindBuffersBase, bind_buffers_base),
+    NULL_GL_PROC(glMapNamedBuffer, map_named_buffer),
+    NULL_GL_PROC(glMapNamedBufferRange, map_named_buffer_range),
+    NULL_GL_PROC(glDispatchCompute, dispatch_compute),
+    NULL_GL_PROC(glDispatchComputeIndirect, dispatch_compute_indirect),
+    NULL_GL_PROC(glMemoryBarrier, memory_barrier),
+
+    NULL_GL_PROC(glGetString, get_string),
+    NULL_GL_PROC(glGetStringi, [](GLenum, GLuint) { return reinterpret_cast<const GLubyte *>("GL_ARB_gl_spirv"); }),
+    NULL_GL_PROC(glGetIntegerv, get_integerv),
+    NULL_GL_PROC(glFinish, []() {}),
+    NULL_GL_PROC(glEnable, [](GLenum) {}),
+    NULL_GL_PROC(glBlendFunc, [](GLenum, GLenum) {}),
+    NULL_GL_PROC(glViewport, [](GLint, GLint, GLsizei, GLsizei) {}),
+    NULL_GL_PROC(glClear, [](GLbitfield) {}),
+
+    NULL_GL_PROC(glCreateBuffers, create_buffers),
+    NULL_GL_PROC(glDeleteBuffers, delete_buffers),
+    NULL_GL_PROC(glNamedBufferStorage, named_buffer_storage),
+    NULL_GL_PROC(glNamedBufferSubData, [](GLuint, GLintptr, GLsizeiptr, const void *) {}),
+    NULL_GL_PROC(glGetNamedBufferSubData, get_named_buffer_sub_data),
+    NULL_GL_PROC(glCopyNamedBufferSubData, [](GLuint, GLuint, GLintptr, GLintptr, GLsizeiptr) {}),
+    NULL_GL_PROC(glClearNamedBufferData, [](GLuint, GLenum, GLenum, GLenum, const void *) {}),
+    NULL_GL_PROC(
+        glClearNamedBufferSubData, [](GLuint, GLenum, GLintptr, GLsizeiptr, GLenum, GLenum, const void *) {}
+    ),
+    NULL_GL_PROC(glUnmapNamedBuffer, [](GLuint) -> GLboolean { return GL_TRUE; }),
+    NULL_GL_PROC(glBindBuffer, [](GLenum, GLuint) {}),
+    NULL_GL_PROC(glBindBufferRange, [](GLenum, GLuint, GLuint, GLintptr, GLsizeiptr) {}),
+
+    NULL_GL_PROC(glCreateShader, [](GLenum) { return next_name++; }),
+    NULL_GL_PROC(glDeleteShader, [](GLuint) {}),
+    NULL_GL_PROC(glShaderSource, [](GLuint, GLsizei, const GLchar *const *, const GLint *) {}),
+    NULL_GL_PROC(glCompileShader, [](GLuint) {}),
+    NULL_GL_PROC(glShaderBinary, [](GLsizei, const GLuint *, GLenum, const void *, GLsizei) {}),
+    NULL_GL_PROC(glSpecializeShader, [](GLuint, const GLchar *, GLuint, const GLuint *, const GLuint *) {}),
+    NULL_GL_PROC(glGetShaderiv, get_object_iv),
+    NULL_GL_PROC(glGetShaderInfoLog, get_info_log),
+    NULL_GL_PROC(glCreateProgram, []() { return next_name++; }),
+    NULL_GL_PROC(glDeleteProgram, [](GLuint) {}),
+    NULL_GL_PROC(glAttachShader, [](GLuint, GLuint) {}),
+    NULL_GL_PROC(glDetachShader, [](GLuint, GLuint) {}),
+    NULL_GL_PROC(glLinkProgram, [](GLuint) {}),
+    NULL_GL_PROC(glGetProgramiv, get_object_iv),
+    NULL_GL_PROC(glGetProgramInfoLog, get_info_log),
+
+    NULL_GL_PROC(glCreateQueries, [](GLenum, GLsizei n, GLuint *names) { create_names(n, names); }),
+    NULL_GL_PROC(glDeleteQueries, [](GLsizei, const GLuint *) {}),
+    NULL_GL_PROC(glBeginQuery, [](GLenum, GLuint) {}),
+    NULL_GL_PROC(glEndQuery, [](GLenum) {}),
+    NULL_GL_PROC(glGetQueryObjectiv, get_query_object_iv),
+    NULL_GL_PROC(glGetQueryObjectui64v, [](GLuint, GLenum, GLuint64 *data) { *data = 0; }),
+    NULL_GL_PROC(glFenceSync, fence_sync),
+    NULL_GL_PROC(glDeleteSync, [](GLsync) {}),
+    NULL_GL_PROC(glClientWaitSync, [](GLsync, GLbitfield, GLuint64) -> GLenum { return GL_ALREADY_SIGNALED; }),
+
+    NULL_GL_PROC(glCreateTextures, [](GLenum, GLsizei n, GLuint *names) { create_names(n, names); }),
+    NULL_GL_PROC(glDeleteTextures, [](GLsizei, const GLuint *) {}),
+    NULL_GL_PROC(glTextureStorage2D, [](GLuint, GLsizei, GLenum, GLsizei, GLsizei) {}),
+    NULL_GL_PROC(
+        glTextureSubImage2D, [](GLuint, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void *) {}
+    ),
+    NULL_GL_PROC(glTextureParameteri, [](GLuint, GLenum, GLint) {}),
+    NULL_GL_PROC(glGenerateTextureMipmap, [](GLuint) {}),
+    NULL_GL_PROC(glBindTextureUnit, [](GLuint, GLuint) {}),
+
+    NULL_GL_PROC(glCreateVertexArrays, [](GLsizei n, GLuint *names) { create_names(n, names); }),
+    NULL_GL_PROC(glDeleteVertexArrays, [](GLsizei, const GLuint *) {}),
+    NULL_GL_PROC(glVertexArrayElementBuffer, [](GLuint, GLuint) {}),
+    NULL_GL_PROC(glBindVertexArray, [](GLuint) {}),
+    NULL_GL_PROC(glDrawElementsInstanced, [](GLenum, GLsizei, GLenum, const void *, GLsizei) {}),
+    NULL_GL_PROC(glDrawElementsIndirect, [](GLenum, GLenum, const void *) {}),
+    NULL_GL_PROC(glDrawArraysIndirect, [](GLenum, const void *) {}),
+    NULL_GL_PROC(glDrawArrays, [](GLenum, GLint, GLsizei) {}),
+};
+
+#undef NULL_GL_PROC
+
+// functions without a stub are left null by glad
+void *get_proc_address(const char *name) {
+    for (const auto &proc : kProcs) {
+        if (std::strcmp(proc.name, name) == 0) {
+            return proc.proc;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+const char *null_gl_function_name(NullGlFunction function) {
+    static const char *kNames[] = {
+        "glUseProgram",
+        "glBindBuffersBase",
+        "glMapNamedBuffer",
+        "glMapNamedBufferRange",
+        "glDispatchCompute",
+        "glDispatchComputeIndirect",
+        "glMemoryBarrier",
+    };
+    return kNames[function];
+}
+
+bool load_null_gl() {
+    loaded = gladLoadGLLoader(get_proc_address) != 0;
+    return loaded;
+}
+
+bool null_gl_loaded() {
+    return loaded;
+}
+
+const std::vector<NullGlCall> &null_gl_calls() {
+    return calls;
+}
+
+void clear_null_gl_calls() {
+    calls.clear();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// OpenGL without a driver, to measure the CPU cost of submitting work on machines without GPU.
+// 'load_null_gl()' points functions of glad at stubs: objects are only names, mapped buffers are host memory,
+// queries and fences are always complete, and reads return zeros. Calls of the functions below, which bind
+// and submit work, are recorded with a timestamp.
+enum NullGlFunction {
+    eNullGlUseProgram,
+    eNullGlBindBuffersBase,
+    eNullGlMapNamedBuffer,
+    eNullGlMapNamedBufferRange,
+    eNullGlDispatchCompute,
+    eNullGlDispatchComputeIndirect,
+    eNullGlMemoryBarrier,
+    eNumNullGlFunctions,
+};
+
+// such as "glUseProgram"
+const char *null_gl_function_name(NullGlFunction function);
+
+struct NullGlCall {
+    NullGlFunction function;
+    std::chrono::steady_clock::time_point time;
+};
+
+// replaces the functions loaded by glad, no context is needed, returns whether glad accepted them
+bool load_null_gl();
+bool null_gl_loaded();
+
+// in order, since the last 'clear_null_gl_calls()'
+const std::vector<NullGlCall> &null_gl_calls();
+void clear_null_gl_calls();
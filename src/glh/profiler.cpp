@@ -0,0 +1,62 @@
+#include "profiler.hpp"
+
+#include <cassert>
+
+#include <glad/glad.h>
+
+GlProfiler::GlProfiler(uint32_t num_scopes, uint32_t num_frames, uint32_t window)
+    : num_scopes_(num_scopes), num_frames_(num_frames),
+    queries_(num_scopes * num_frames), issued_(num_scopes * num_frames, false),
+    samples_(num_scopes, SampleWindow(window)) {
+    glCreateQueries(GL_TIME_ELAPSED, static_cast<int>(queries_.size()), queries_.data());
+}
+
+GlProfiler::~GlProfiler() {
+    glDeleteQueries(static_cast<int>(queries_.size()), queries_.data());
+}
+
+void GlProfiler::begin_frame() {
+    curr_frame_ = (curr_frame_ + 1) % num_frames_;
+
+    for (uint32_t scope = 0; scope < num_scopes_; scope++) {
+        auto index = curr_frame_ * num_scopes_ + scope;
+        if (!issued_[index]) {
+            continue;
+        }
+        issued_[index] = false;
+
+        int available = 0;
+        glGetQueryObjectiv(queries_[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        uint64_t elapsed_ns = 0;
+        glGetQueryObjectui64v(queries_[index], GL_QUERY_RESULT, &elapsed_ns);
+
+        samples_[scope].add(elapsed_ns * 1e-6f);
+    }
+}
+
+void GlProfiler::flush() {
+    for (uint32_t index = 0; index < queries_.size(); index++) {
+        if (!issued_[index]) {
+            continue;
+        }
+        issued_[index] = false;
+
+        uint64_t elapsed_ns = 0;
+        glGetQueryObjectui64v(queries_[index], GL_QUERY_RESULT, &elapsed_ns);
+        samples_[index % num_scopes_].add(elapsed_ns * 1e-6f);
+    }
+}
+
+void GlProfiler::begin(uint32_t scope) {
+    assert(scope < num_scopes_);
+    auto index = curr_frame_ * num_scopes_ + scope;
+    glBeginQuery(GL_TIME_ELAPSED, queries_[index]);
+    issued_[index] = true;
+}
+
+void GlProfiler::end() {
+    glEndQuery(GL_TIME_ELAPSED);
+}
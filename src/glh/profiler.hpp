@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../utils/sample_window.hpp"
+
+// GPU time of a fixed set of scopes, measured with GL_TIME_ELAPSED queries.
+// Queries are kept in a ring of 'num_frames' frames and read back when their frame slot is reused,
+// results not available by then are dropped rather than waited for.
+class GlProfiler {
+public:
+    GlProfiler(uint32_t num_scopes, uint32_t num_frames = 4, uint32_t window = 64);
+    ~GlProfiler();
+
+    void begin_frame();
+    // waits for every issued query and reads it back
+    void flush();
+
+    // scopes can't be nested
+    void begin(uint32_t scope);
+    void end();
+
+    using Stats = SampleWindow::Stats;
+    // over the last 'window' samples
+    Stats stats(uint32_t scope) const { return samples_[scope].stats(); }
+
+private:
+    uint32_t num_scopes_;
+    uint32_t num_frames_;
+    uint32_t curr_frame_ = 0;
+    // 'num_scopes' queries per frame
+    std::vector<uint32_t> queries_;
+    std::vector<bool> issued_;
+    // one per scope
+    std::vector<SampleWindow> samples_;
+};
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include <glad/glad.h>
 
@@ -30,10 +31,19 @@ GlShader::GlShader(const char *source, uint32_t type) {
     }
 }
 
-GlShader::GlShader(const uint8_t *binary, uint32_t length, uint32_t type) {
+GlShader::GlShader(
+    const uint8_t *binary, uint32_t length, uint32_t type, std::span<const GlSpecConstant> spec_constants
+) {
+    std::vector<uint32_t> spec_ids(spec_constants.size());
+    std::vector<uint32_t> spec_values(spec_constants.size());
+    for (size_t i = 0; i < spec_constants.size(); i++) {
+        spec_ids[i] = spec_constants[i].id;
+        spec_values[i] = spec_constants[i].value;
+    }
+
     shader_ = glCreateShader(type);
     glShaderBinary(1, &shader_, GL_SHADER_BINARY_FORMAT_SPIR_V, binary, length);
-    glSpecializeShader(shader_, "main", 0, nullptr, nullptr);
+    glSpecializeShader(shader_, "main", spec_constants.size(), spec_ids.data(), spec_values.data());
 
     int ret;
     glGetShaderiv(shader_, GL_COMPILE_STATUS, &ret);
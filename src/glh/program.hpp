@@ -1,11 +1,21 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <span>
+
+struct GlSpecConstant {
+    uint32_t id;
+    uint32_t value;
+};
 
 class GlShader {
 public:
     GlShader(const char *source, uint32_t type);
-    GlShader(const uint8_t *binary, uint32_t length, uint32_t type);
+    GlShader(
+        const uint8_t *binary, uint32_t length, uint32_t type,
+        std::span<const GlSpecConstant> spec_constants = {}
+    );
     ~GlShader();
 
     uint32_t id() const { return shader_; }
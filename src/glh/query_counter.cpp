@@ -0,0 +1,35 @@
+#include "query_counter.hpp"
+
+#include <glad/glad.h>
+
+GlQueryCounter::GlQueryCounter(uint32_t target, uint32_t num_frames)
+    : target_(target), num_frames_(num_frames), queries_(num_frames), issued_(num_frames, false) {
+    glCreateQueries(target_, static_cast<int>(queries_.size()), queries_.data());
+}
+
+GlQueryCounter::~GlQueryCounter() {
+    glDeleteQueries(static_cast<int>(queries_.size()), queries_.data());
+}
+
+void GlQueryCounter::begin_frame() {
+    curr_frame_ = (curr_frame_ + 1) % num_frames_;
+    if (!issued_[curr_frame_]) {
+        return;
+    }
+    issued_[curr_frame_] = false;
+
+    int available = 0;
+    glGetQueryObjectiv(queries_[curr_frame_], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        glGetQueryObjectui64v(queries_[curr_frame_], GL_QUERY_RESULT, &count_);
+    }
+}
+
+void GlQueryCounter::begin() {
+    glBeginQuery(target_, queries_[curr_frame_]);
+    issued_[curr_frame_] = true;
+}
+
+void GlQueryCounter::end() {
+    glEndQuery(target_);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Count of a pipeline statistic over a scope, such as GL_FRAGMENT_SHADER_INVOCATIONS.
+// Like 'GlProfiler', queries are kept in a ring of 'num_frames' frames and read back when their frame slot
+// is reused, results not available by then are dropped rather than waited for.
+class GlQueryCounter {
+public:
+    GlQueryCounter(uint32_t target, uint32_t num_frames = 4);
+    ~GlQueryCounter();
+
+    void begin_frame();
+
+    void begin();
+    void end();
+
+    // of the last scope read back, 0 until then
+    uint64_t count() const { return count_; }
+
+private:
+    uint32_t target_;
+    uint32_t num_frames_;
+    uint32_t curr_frame_ = 0;
+    std::vector<uint32_t> queries_;
+    std::vector<bool> issued_;
+    uint64_t count_ = 0;
+};
@@ -1,6 +1,9 @@
 #include "resource.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstring>
 
 #include <glad/glad.h>
 
@@ -52,6 +55,59 @@ void GlBuffer::unmap() {
     }
 }
 
+GlUploadRing::GlUploadRing(uint64_t frame_size, uint32_t num_frames)
+    : frame_size_(frame_size), num_frames_(num_frames), fences_(num_frames, nullptr) {
+    int alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment_ = std::max<uint64_t>(alignment_, alignment);
+    frame_size_ = (frame_size_ + alignment_ - 1) / alignment_ * alignment_;
+
+    auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &gl_buffer_);
+    glNamedBufferStorage(gl_buffer_, frame_size_ * num_frames_, nullptr, flags);
+    mapped_ptr_ = reinterpret_cast<uint8_t *>(glMapNamedBufferRange(gl_buffer_, 0, frame_size_ * num_frames_, flags));
+}
+
+GlUploadRing::~GlUploadRing() {
+    for (auto fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glUnmapNamedBuffer(gl_buffer_);
+    glDeleteBuffers(1, &gl_buffer_);
+}
+
+void GlUploadRing::begin_frame() {
+    curr_frame_ = (curr_frame_ + 1) % num_frames_;
+    curr_offset_ = 0;
+    // only blocks when GPU is more than 'num_frames_' frames behind
+    if (auto &fence = fences_[curr_frame_]; fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void GlUploadRing::end_frame() {
+    fences_[curr_frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void *GlUploadRing::allocate(uint64_t size, GlBufferRange &range) {
+    assert(curr_offset_ + size <= frame_size_);
+    range.buffer = gl_buffer_;
+    range.offset = curr_frame_ * frame_size_ + curr_offset_;
+    range.size = size;
+    curr_offset_ += (size + alignment_ - 1) / alignment_ * alignment_;
+    return mapped_ptr_ + range.offset;
+}
+
+GlBufferRange GlUploadRing::upload(const void *data, uint64_t size) {
+    GlBufferRange range;
+    std::memcpy(allocate(size, range), data, size);
+    return range;
+}
+
 GlTexture2D::GlTexture2D(uint32_t format, uint32_t width, uint32_t height, uint32_t levels)
     : width_(width), height_(height), levels_(levels), format_(format) {
     if (levels == 0) {
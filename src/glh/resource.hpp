@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
 
 class GlBuffer {
 public:
@@ -22,6 +25,43 @@ private:
     void *mapped_ptr_ = nullptr;
 };
 
+struct GlBufferRange {
+    uint32_t buffer = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// Persistently mapped buffer for per-frame constants, split into 'num_frames' parts guarded by fences.
+// Data uploaded in a frame stays valid until the same part is reused 'num_frames' frames later.
+class GlUploadRing {
+public:
+    GlUploadRing(uint64_t frame_size, uint32_t num_frames = 3);
+    ~GlUploadRing();
+
+    uint32_t id() const { return gl_buffer_; }
+
+    void begin_frame();
+    void end_frame();
+
+    void *allocate(uint64_t size, GlBufferRange &range);
+    template <typename T>
+    T *typed_allocate(GlBufferRange &range) { return reinterpret_cast<T *>(allocate(sizeof(T), range)); }
+
+    GlBufferRange upload(const void *data, uint64_t size);
+    template <typename T>
+    GlBufferRange upload(const T &data) { return upload(&data, sizeof(T)); }
+
+private:
+    uint32_t gl_buffer_ = 0;
+    uint8_t *mapped_ptr_ = nullptr;
+    uint64_t frame_size_;
+    uint32_t num_frames_;
+    uint64_t alignment_ = 256;
+    uint32_t curr_frame_ = 0;
+    uint64_t curr_offset_ = 0;
+    std::vector<GLsync> fences_;
+};
+
 class GlTexture2D {
 public:
     GlTexture2D(uint32_t format, uint32_t width, uint32_t height, uint32_t levels = 0);
@@ -2,13 +2,19 @@
 #include "camera/camera.hpp"
 #include "particles/particle_system.hpp"
 
+namespace {
+
+constexpr uint64_t kUploadRingFrameSize = 64 * 1024;
+
+}
+
 int main(int argc, char **argv) {
     Window window(1280, 720, "particles");
 
-    OrbitCamera camera(glm::vec3(0.0f), 10.0f, window.get_aspect());
-    ParticleSystem particle_system{};
+    GlUploadRing upload_ring(kUploadRingFrameSize);
 
-    particle_system.set_camera_buffer(camera.get_buffer());
+    OrbitCamera camera(glm::vec3(0.0f), 10.0f, window.get_aspect());
+    ParticleSystem particle_system(upload_ring);
 
     window.set_resize_callback([&](uint32_t width, uint32_t height) {
         camera.set_aspect(window.get_aspect());
@@ -25,12 +31,16 @@ int main(int argc, char **argv) {
             float dy = 0.005f * (y - last_y);
             camera.forward(dx - dy);
         }
-        particle_system.set_camera_buffer(camera.get_buffer());
     });
 
     window.main_loop([&]() {
+        upload_ring.begin_frame();
+
+        particle_system.set_camera_buffer(camera.upload(upload_ring), camera.view());
         particle_system.update(ImGui::GetIO().DeltaTime);
 
+        upload_ring.end_frame();
+
         if (ImGui::Begin("Status")) {
             float fps = ImGui::GetIO().Framerate;
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / fps, fps);
@@ -0,0 +1,81 @@
+#include "cpu_isa.hpp"
+
+#if CPU_ISA_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#if CPU_ISA_X86
+struct CpuidRegs {
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+};
+
+CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf) {
+    CpuidRegs regs {};
+#if defined(_MSC_VER)
+    int data[4];
+    __cpuidex(data, static_cast<int>(leaf), static_cast<int>(subleaf));
+    regs = { uint32_t(data[0]), uint32_t(data[1]), uint32_t(data[2]), uint32_t(data[3]) };
+#else
+    __get_cpuid_count(leaf, subleaf, &regs.eax, &regs.ebx, &regs.ecx, &regs.edx);
+#endif
+    return regs;
+}
+
+// register state enabled by OS
+uint64_t xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax;
+    uint32_t edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32) | eax;
+#endif
+}
+#endif
+
+}
+
+CpuIsa detect_cpu_isa() {
+#if CPU_ISA_X86
+    if (cpuid(0, 0).eax < 7) {
+        return eIsaScalar;
+    }
+    auto leaf1 = cpuid(1, 0);
+    auto leaf7 = cpuid(7, 0);
+
+    bool sse42 = (leaf1.ecx & (1u << 20)) != 0;
+    if (!sse42) {
+        return eIsaScalar;
+    }
+
+    // AVX registers must also be saved by OS, XMM and YMM state
+    bool osxsave = (leaf1.ecx & (1u << 27)) != 0;
+    uint64_t xcr0 = osxsave ? xgetbv() : 0;
+    bool avx2 = (leaf1.ecx & (1u << 28)) != 0 && (leaf7.ebx & (1u << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+    if (!avx2) {
+        return eIsaSse42;
+    }
+
+    // plus opmask and ZMM state
+    bool avx512 = (leaf7.ebx & (1u << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+    return avx512 ? eIsaAvx512 : eIsaAvx2;
+#else
+    return eIsaScalar;
+#endif
+}
+
+const char *cpu_isa_name(CpuIsa isa) {
+    const char *names[] = { "scalar", "sse4.2", "avx2", "avx-512" };
+    return names[isa];
+}
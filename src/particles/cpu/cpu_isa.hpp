@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_ISA_X86 1
+#else
+#define CPU_ISA_X86 0
+#endif
+
+// instruction sets of CPU kernels, each one implies the previous ones
+enum CpuIsa {
+    eIsaScalar,
+    eIsaSse42,
+    eIsaAvx2,
+    eIsaAvx512,
+    eNumIsas,
+};
+
+// best instruction set supported by both CPU and OS, detected with cpuid and xgetbv
+CpuIsa detect_cpu_isa();
+
+const char *cpu_isa_name(CpuIsa isa);
@@ -0,0 +1,56 @@
+#include "emit_kernel_simd.hpp"
+#include "simd_scalar.hpp"
+
+EmitKernelParams make_emit_kernel_params(const ParticleEmitParams &params) {
+    EmitKernelParams kernel_params;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        kernel_params.position[axis] = params.position[axis];
+    }
+    kernel_params.position_radius = params.position_radius;
+
+    // same as 'emit.comp'
+    float speed = glm::length(params.velocity);
+    glm::vec3 frame_z = speed == 0.0f ? glm::vec3(0.0f, 0.0f, 1.0f) : params.velocity / speed;
+    float sign = frame_z.z > 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (sign + frame_z.z);
+    const float b = frame_z.x * frame_z.y * a;
+    glm::vec3 frame_x(1.0f + sign * frame_z.x * frame_z.x * a, sign * b, -sign * frame_z.x);
+    glm::vec3 frame_y(b, sign + frame_z.y * frame_z.y * a, -frame_z.y);
+    kernel_params.speed = speed;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        kernel_params.frame_x[axis] = frame_x[axis];
+        kernel_params.frame_y[axis] = frame_y[axis];
+        kernel_params.frame_z[axis] = frame_z[axis];
+    }
+
+    kernel_params.velocity_angle_cos = params.velocity_angle_cos;
+    kernel_params.mass_min = params.mass_min;
+    kernel_params.mass_max = params.mass_max;
+    kernel_params.life_min = params.life_min;
+    kernel_params.life_max = params.life_max;
+    kernel_params.size_min = params.size_min;
+    kernel_params.size_max = params.size_max;
+    kernel_params.seed = params.seed;
+    return kernel_params;
+}
+
+void emit_particles_scalar(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+) {
+    emit_particles_simd<Scalar>(fields, begin, end, params);
+}
+
+EmitKernel get_emit_kernel(CpuIsa isa) {
+    switch (isa) {
+#if CPU_ISA_X86
+        case eIsaSse42:
+            return emit_particles_sse42;
+        case eIsaAvx2:
+            return emit_particles_avx2;
+        case eIsaAvx512:
+            return emit_particles_avx512;
+#endif
+        default:
+            return emit_particles_scalar;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "cpu_isa.hpp"
+#include "particle_fields.hpp"
+#include "../particle_backend.hpp"
+
+// 'ParticleEmitParams' in plain floats, together with the frame around the emission direction, which is the same
+// for every particle. Kernels compiled for an instruction set must not call inline functions shared with other
+// translation units, such as those of glm: the copies they emit use that instruction set, and the linker may pick
+// them for callers on any CPU.
+struct EmitKernelParams {
+    float position[3];
+    float position_radius;
+    float speed;
+    // orthonormal, 'frame_z' along the velocity
+    float frame_x[3];
+    float frame_y[3];
+    float frame_z[3];
+    float velocity_angle_cos;
+    float mass_min;
+    float mass_max;
+    float life_min;
+    float life_max;
+    float size_min;
+    float size_max;
+    uint32_t seed;
+};
+
+// 'params.count' is ignored
+EmitKernelParams make_emit_kernel_params(const ParticleEmitParams &params);
+
+// Particles ['begin', 'end') of 'emit.comp', each drawn from its index and 'params.seed'.
+// Every variant produces bit identical results.
+using EmitKernel = void (*)(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+);
+
+void emit_particles_scalar(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+);
+#if CPU_ISA_X86
+void emit_particles_sse42(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+);
+void emit_particles_avx2(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+);
+void emit_particles_avx512(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+);
+#endif
+
+// 'isa' must be supported, see 'detect_cpu_isa()'
+EmitKernel get_emit_kernel(CpuIsa isa);
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "emit_kernel.hpp"
+
+// Port of 'rand.glsl', 'sample.glsl' and 'emit.comp' over 'Simd::kWidth' lanes at a time, 'Simd' wraps the
+// intrinsics of an instruction set (see 'simd_sse42.hpp'). The scalar kernel is the same template over plain
+// floats, so that every variant gives the same bits. No inline function shared with other translation units is
+// called, see 'EmitKernelParams'.
+// Integer results are the same as on GPU bit for bit. Sine, cosine and cube root are polynomials and Newton
+// iterations instead of libm, they're within a few ulps, tighter than the precision GLSL requires.
+
+constexpr float kPi = 3.14159265359f;
+constexpr float kTwoPi = 2.0f * kPi;
+
+template <typename Simd>
+typename Simd::U rng_tea(typename Simd::U val0, typename Simd::U val1) {
+    using U = typename Simd::U;
+
+    U v0 = val0;
+    U v1 = val1;
+    uint32_t s0 = 0;
+
+    for (uint32_t n = 0; n < 16; n++) {
+        s0 += 0x9e3779b9;
+        U s = Simd::set1u(s0);
+        v0 = Simd::addu(v0, Simd::xoru(
+            Simd::xoru(Simd::addu(Simd::template shl<4>(v1), Simd::set1u(0xa341316c)), Simd::addu(v1, s)),
+            Simd::addu(Simd::template shr<5>(v1), Simd::set1u(0xc8013ea4))
+        ));
+        v1 = Simd::addu(v1, Simd::xoru(
+            Simd::xoru(Simd::addu(Simd::template shl<4>(v0), Simd::set1u(0xad90777d)), Simd::addu(v0, s)),
+            Simd::addu(Simd::template shr<5>(v0), Simd::set1u(0x7e95761e))
+        ));
+    }
+
+    return v0;
+}
+
+template <typename Simd>
+typename Simd::V rng_next(typename Simd::U &prev) {
+    const uint32_t kLcgA = 1664525u;
+    const uint32_t kLcgC = 1013904223u;
+    prev = Simd::addu(Simd::mulu(Simd::set1u(kLcgA), prev), Simd::set1u(kLcgC));
+    auto bits = Simd::andu(prev, Simd::set1u(0x00FFFFFF));
+    // multiplying by the inverse of a power of two is exact, same as dividing
+    return Simd::mul(Simd::to_float(bits), Simd::set1(1.0f / static_cast<float>(0x01000000)));
+}
+
+// sine and cosine of 2 pi 't', for 't' in [0, 1]
+template <typename Simd>
+void sin_cos_two_pi(typename Simd::V t, typename Simd::V &sin, typename Simd::V &cos) {
+    using V = typename Simd::V;
+    using U = typename Simd::U;
+
+    // quadrant, the remainder is exact since 't' is a multiple of 2^-24
+    U quadrant = Simd::to_uint(Simd::add(Simd::mul(t, Simd::set1(4.0f)), Simd::set1(0.5f)));
+    V remainder = Simd::sub(t, Simd::mul(Simd::to_float(quadrant), Simd::set1(0.25f)));
+    V x = Simd::mul(remainder, Simd::set1(kTwoPi));
+    V x2 = Simd::mul(x, x);
+
+    // minimax polynomials on [-pi / 4, pi / 4] from Cephes
+    V sin_x = Simd::set1(-1.9515295891e-4f);
+    sin_x = Simd::add(Simd::mul(sin_x, x2), Simd::set1(8.3321608736e-3f));
+    sin_x = Simd::add(Simd::mul(sin_x, x2), Simd::set1(-1.6666654611e-1f));
+    sin_x = Simd::add(Simd::mul(Simd::mul(sin_x, x2), x), x);
+    V cos_x = Simd::set1(2.443315711809948e-5f);
+    cos_x = Simd::add(Simd::mul(cos_x, x2), Simd::set1(-1.388731625493765e-3f));
+    cos_x = Simd::add(Simd::mul(cos_x, x2), Simd::set1(4.166664568298827e-2f));
+    cos_x = Simd::add(
+        Simd::sub(Simd::mul(Simd::mul(cos_x, x2), x2), Simd::mul(x2, Simd::set1(0.5f))), Simd::set1(1.0f)
+    );
+
+    const V zero = Simd::set1(0.0f);
+    const U one = Simd::set1u(1);
+    const U two = Simd::set1u(2);
+    auto swap = Simd::equalu(Simd::andu(quadrant, one), one);
+    auto negate_sin = Simd::equalu(Simd::andu(quadrant, two), two);
+    auto negate_cos = Simd::equalu(Simd::andu(Simd::addu(quadrant, one), two), two);
+    sin = Simd::select(swap, cos_x, sin_x);
+    cos = Simd::select(swap, sin_x, cos_x);
+    sin = Simd::select(negate_sin, Simd::sub(zero, sin), sin);
+    cos = Simd::select(negate_cos, Simd::sub(zero, cos), cos);
+}
+
+// cube root of 'x' in [0, 1], 'pow(x, 1.0 / 3.0)'
+template <typename Simd>
+typename Simd::V cbrt(typename Simd::V x) {
+    using V = typename Simd::V;
+
+    // a third of the exponent from the bits, then Newton iterations
+    const V third = Simd::set1(1.0f / 3.0f);
+    V y = Simd::from_bits(Simd::addu(
+        Simd::to_uint(Simd::mul(Simd::to_float(Simd::bits(x)), third)), Simd::set1u(0x2a5137a0)
+    ));
+    for (uint32_t n = 0; n < 4; n++) {
+        y = Simd::mul(Simd::add(Simd::add(y, y), Simd::div(x, Simd::mul(y, y))), third);
+    }
+    const V zero = Simd::set1(0.0f);
+    return Simd::select(Simd::greater(x, zero), y, zero);
+}
+
+template <typename Simd>
+void emit_particles_simd(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+) {
+    using V = typename Simd::V;
+    using U = typename Simd::U;
+
+    const V zero = Simd::set1(0.0f);
+    const V one = Simd::set1(1.0f);
+    const V two = Simd::set1(2.0f);
+    const U seed = Simd::set1u(params.seed);
+
+    uint32_t i = begin;
+    for (; i + Simd::kWidth <= end; i += Simd::kWidth) {
+        U rng_seed = rng_tea<Simd>(Simd::index(i), seed);
+
+        // random numbers are drawn in the same order as in 'emit.comp'
+        V position_rand_x = rng_next<Simd>(rng_seed);
+        V position_rand_y = rng_next<Simd>(rng_seed);
+        V position_rand_z = rng_next<Simd>(rng_seed);
+
+        // uniform_sample_sphere_volume
+        V position_r = cbrt<Simd>(position_rand_z);
+        V position_sin_phi;
+        V position_cos_phi;
+        sin_cos_two_pi<Simd>(position_rand_x, position_sin_phi, position_cos_phi);
+        V position_z = Simd::sub(Simd::mul(position_rand_y, two), one);
+        V position_sin_theta = Simd::sqrt(Simd::max(Simd::sub(one, Simd::mul(position_z, position_z)), zero));
+        V position_local[] = {
+            Simd::mul(position_cos_phi, position_sin_theta),
+            Simd::mul(position_sin_phi, position_sin_theta),
+            position_z,
+        };
+
+        V velocity_rand_x = rng_next<Simd>(rng_seed);
+        V velocity_rand_y = rng_next<Simd>(rng_seed);
+
+        // uniform_sample_cone
+        V velocity_cos_theta = Simd::add(
+            Simd::sub(one, velocity_rand_x), Simd::mul(velocity_rand_x, Simd::set1(params.velocity_angle_cos))
+        );
+        V velocity_sin_theta = Simd::sqrt(Simd::sub(one, Simd::mul(velocity_cos_theta, velocity_cos_theta)));
+        V velocity_sin_phi;
+        V velocity_cos_phi;
+        sin_cos_two_pi<Simd>(velocity_rand_y, velocity_sin_phi, velocity_cos_phi);
+        V velocity_local_x = Simd::mul(velocity_cos_phi, velocity_sin_theta);
+        V velocity_local_y = Simd::mul(velocity_sin_phi, velocity_sin_theta);
+
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            V position = Simd::add(
+                Simd::set1(params.position[axis]),
+                Simd::mul(Simd::mul(position_local[axis], position_r), Simd::set1(params.position_radius))
+            );
+            V velocity_world = Simd::add(
+                Simd::add(
+                    Simd::mul(Simd::set1(params.frame_x[axis]), velocity_local_x),
+                    Simd::mul(Simd::set1(params.frame_y[axis]), velocity_local_y)
+                ),
+                Simd::mul(Simd::set1(params.frame_z[axis]), velocity_cos_theta)
+            );
+            Simd::store(fields.data[eFieldPositionX + axis] + i, position);
+            Simd::store(fields.data[eFieldVelocityX + axis] + i, Simd::mul(velocity_world, Simd::set1(params.speed)));
+            Simd::store(fields.data[eFieldAccelerationX + axis] + i, zero);
+        }
+
+        V mass = Simd::add(
+            Simd::mul(rng_next<Simd>(rng_seed), Simd::set1(params.mass_max - params.mass_min)),
+            Simd::set1(params.mass_min)
+        );
+        V life = Simd::add(
+            Simd::mul(rng_next<Simd>(rng_seed), Simd::set1(params.life_max - params.life_min)),
+            Simd::set1(params.life_min)
+        );
+        V size = Simd::add(
+            Simd::mul(rng_next<Simd>(rng_seed), Simd::set1(params.size_max - params.size_min)),
+            Simd::set1(params.size_min)
+        );
+        Simd::store(fields.data[eFieldMass] + i, mass);
+        Simd::store(fields.data[eFieldLife] + i, life);
+        Simd::store(fields.data[eFieldSize] + i, size);
+    }
+
+    if (i < end) {
+        emit_particles_scalar(fields, i, end, params);
+    }
+}
@@ -0,0 +1,13 @@
+#include "emit_kernel_simd.hpp"
+
+#if CPU_ISA_X86
+
+#include "simd_sse42.hpp"
+
+void emit_particles_sse42(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const EmitKernelParams &params
+) {
+    emit_particles_simd<Sse42>(fields, begin, end, params);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Particles of the CPU backend are stored as structure of arrays, one float stream per member of 'Particle',
+// so that kernels load full vectors of lanes.
+enum ParticleField : uint32_t {
+    eFieldPositionX,
+    eFieldPositionY,
+    eFieldPositionZ,
+    eFieldVelocityX,
+    eFieldVelocityY,
+    eFieldVelocityZ,
+    eFieldAccelerationX,
+    eFieldAccelerationY,
+    eFieldAccelerationZ,
+    eFieldMass,
+    eFieldLife,
+    eFieldSize,
+    eNumFields,
+};
+
+struct ParticleFields {
+    float *data[eNumFields];
+
+    float *operator[](uint32_t field) const { return data[field]; }
+};
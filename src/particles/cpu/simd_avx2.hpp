@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+// Traits of AVX2 for kernel templates, see 'update_kernel_simd.hpp' and 'emit_kernel_simd.hpp'.
+// Only included by translation units compiled for it.
+struct Avx2 {
+    using V = __m256;
+    using U = __m256i;
+    using M = __m256;
+    static constexpr uint32_t kWidth = 8;
+
+    static V load(const float *ptr) { return _mm256_loadu_ps(ptr); }
+    static void store(float *ptr, V v) { _mm256_storeu_ps(ptr, v); }
+    static V set1(float x) { return _mm256_set1_ps(x); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static M greater(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static V select(M mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+
+    static U set1u(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    // 'base' + lane
+    static U index(uint32_t base) {
+        return _mm256_add_epi32(set1u(base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+    static U addu(U a, U b) { return _mm256_add_epi32(a, b); }
+    static U mulu(U a, U b) { return _mm256_mullo_epi32(a, b); }
+    static U andu(U a, U b) { return _mm256_and_si256(a, b); }
+    static U xoru(U a, U b) { return _mm256_xor_si256(a, b); }
+    template <int n> static U shl(U a) { return _mm256_slli_epi32(a, n); }
+    template <int n> static U shr(U a) { return _mm256_srli_epi32(a, n); }
+    static M equalu(U a, U b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+    // conversions of values below 2^31, from float by truncation
+    static V to_float(U a) { return _mm256_cvtepi32_ps(a); }
+    static U to_uint(V a) { return _mm256_cvttps_epi32(a); }
+    static U bits(V a) { return _mm256_castps_si256(a); }
+    static V from_bits(U a) { return _mm256_castsi256_ps(a); }
+};
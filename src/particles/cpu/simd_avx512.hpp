@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+// Traits of AVX-512 for kernel templates, see 'update_kernel_simd.hpp' and 'emit_kernel_simd.hpp'.
+// Only included by translation units compiled for it.
+struct Avx512 {
+    using V = __m512;
+    using U = __m512i;
+    // one bit per lane
+    using M = __mmask16;
+    static constexpr uint32_t kWidth = 16;
+
+    static V load(const float *ptr) { return _mm512_loadu_ps(ptr); }
+    static void store(float *ptr, V v) { _mm512_storeu_ps(ptr, v); }
+    static V set1(float x) { return _mm512_set1_ps(x); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+    static M greater(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static V select(M mask, V a, V b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+    static U set1u(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    // 'base' + lane
+    static U index(uint32_t base) {
+        return _mm512_add_epi32(
+            set1u(base), _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+        );
+    }
+    static U addu(U a, U b) { return _mm512_add_epi32(a, b); }
+    static U mulu(U a, U b) { return _mm512_mullo_epi32(a, b); }
+    static U andu(U a, U b) { return _mm512_and_si512(a, b); }
+    static U xoru(U a, U b) { return _mm512_xor_si512(a, b); }
+    template <int n> static U shl(U a) { return _mm512_slli_epi32(a, n); }
+    template <int n> static U shr(U a) { return _mm512_srli_epi32(a, n); }
+    static M equalu(U a, U b) { return _mm512_cmpeq_epi32_mask(a, b); }
+    // conversions of values below 2^31, from float by truncation
+    static V to_float(U a) { return _mm512_cvtepi32_ps(a); }
+    static U to_uint(V a) { return _mm512_cvttps_epi32(a); }
+    static U bits(V a) { return _mm512_castps_si512(a); }
+    static V from_bits(U a) { return _mm512_castsi512_ps(a); }
+};
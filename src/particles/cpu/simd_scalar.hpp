@@ -0,0 +1,43 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Traits of a single lane for kernel templates, so that scalar kernels are the same code as SIMD ones,
+// see 'update_kernel_simd.hpp' and 'emit_kernel_simd.hpp'. Only included by translation units compiled
+// for the baseline instruction set.
+struct Scalar {
+    using V = float;
+    using U = uint32_t;
+    using M = bool;
+    static constexpr uint32_t kWidth = 1;
+
+    static V load(const float *ptr) { return *ptr; }
+    static void store(float *ptr, V v) { *ptr = v; }
+    static V set1(float x) { return x; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    // correctly rounded, same as SIMD
+    static V sqrt(V a) { return std::sqrt(a); }
+    // second value if unordered, same as SIMD
+    static V max(V a, V b) { return a > b ? a : b; }
+    static M greater(V a, V b) { return a > b; }
+    static V select(M mask, V a, V b) { return mask ? a : b; }
+
+    static U set1u(uint32_t x) { return x; }
+    static U index(uint32_t base) { return base; }
+    static U addu(U a, U b) { return a + b; }
+    static U mulu(U a, U b) { return a * b; }
+    static U andu(U a, U b) { return a & b; }
+    static U xoru(U a, U b) { return a ^ b; }
+    template <int n> static U shl(U a) { return a << n; }
+    template <int n> static U shr(U a) { return a >> n; }
+    static M equalu(U a, U b) { return a == b; }
+    static V to_float(U a) { return static_cast<float>(static_cast<int32_t>(a)); }
+    static U to_uint(V a) { return static_cast<uint32_t>(static_cast<int32_t>(a)); }
+    static U bits(V a) { return std::bit_cast<U>(a); }
+    static V from_bits(U a) { return std::bit_cast<V>(a); }
+};
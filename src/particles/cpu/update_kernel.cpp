@@ -0,0 +1,31 @@
+#include "update_kernel_simd.hpp"
+#include "simd_scalar.hpp"
+
+uint32_t get_update_terms(const ParticleUpdateParams &params) {
+    uint32_t terms = 0;
+    if (params.force != glm::vec3(0.0f)) {
+        terms |= eUpdateForce;
+    }
+    if (params.drag != 0.0f) {
+        terms |= eUpdateDrag;
+    }
+    if (params.gravity != 0.0f) {
+        terms |= eUpdateGravity;
+    }
+    return terms;
+}
+
+UpdateKernel get_update_kernel(CpuIsa isa, uint32_t terms) {
+    switch (isa) {
+#if CPU_ISA_X86
+        case eIsaSse42:
+            return get_update_kernel_sse42(terms);
+        case eIsaAvx2:
+            return get_update_kernel_avx2(terms);
+        case eIsaAvx512:
+            return get_update_kernel_avx512(terms);
+#endif
+        default:
+            return get_update_kernel_simd<Scalar>(terms);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "cpu_isa.hpp"
+#include "particle_fields.hpp"
+#include "../particle_backend.hpp"
+
+// Velocity Verlet steps of 'update.comp' over particles ['begin', 'end'), all substeps of a particle are run
+// in one pass over memory, dead particles are left untouched.
+// Every variant produces bit identical results.
+using UpdateKernel = void (*)(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const ParticleUpdateParams &params
+);
+
+// Terms of the acceleration, kernels are specialized for each set of them, so that terms which are zero
+// cost nothing. Without force and drag, the acceleration is the same for every particle and there is no division.
+enum UpdateTerm {
+    eUpdateForce = 1 << 0,
+    eUpdateDrag = 1 << 1,
+    eUpdateGravity = 1 << 2,
+    eNumUpdateTermSets = 1 << 3,
+};
+
+// terms which aren't zero in 'params'
+uint32_t get_update_terms(const ParticleUpdateParams &params);
+
+#if CPU_ISA_X86
+UpdateKernel get_update_kernel_sse42(uint32_t terms);
+UpdateKernel get_update_kernel_avx2(uint32_t terms);
+UpdateKernel get_update_kernel_avx512(uint32_t terms);
+#endif
+
+// 'isa' must be supported, see 'detect_cpu_isa()', and the kernel must only be given params with 'terms'.
+// Leaving out terms which are zero may only change the sign of zero accelerations.
+UpdateKernel get_update_kernel(CpuIsa isa, uint32_t terms);
@@ -0,0 +1,11 @@
+#include "update_kernel_simd.hpp"
+
+#if CPU_ISA_X86
+
+#include "simd_avx2.hpp"
+
+UpdateKernel get_update_kernel_avx2(uint32_t terms) {
+    return get_update_kernel_simd<Avx2>(terms);
+}
+
+#endif
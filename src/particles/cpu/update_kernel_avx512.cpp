@@ -0,0 +1,11 @@
+#include "update_kernel_simd.hpp"
+
+#if CPU_ISA_X86
+
+#include "simd_avx512.hpp"
+
+UpdateKernel get_update_kernel_avx512(uint32_t terms) {
+    return get_update_kernel_simd<Avx512>(terms);
+}
+
+#endif
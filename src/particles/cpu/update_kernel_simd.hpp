@@ -0,0 +1,109 @@
+#pragma once
+
+#include "update_kernel.hpp"
+
+// Update kernel over 'Simd::kWidth' lanes at a time, 'Simd' wraps the intrinsics of an instruction set
+// (see 'simd_sse42.hpp'): vector type 'V', mask type 'M', unaligned 'load' and 'store', 'set1', arithmetic,
+// 'greater' comparison and 'select' of the first value where the mask is set.
+// 'kTerms' are the terms of the acceleration which are computed, see 'UpdateTerm'.
+// Only included by the translation unit of each instruction set, which is compiled for it, so no inline function
+// shared with other translation units is called, not even 'ParticleFields::operator[]', see 'EmitKernelParams'.
+template <typename Simd, uint32_t kTerms>
+void update_particles_simd(
+    const ParticleFields &fields, uint32_t begin, uint32_t end, const ParticleUpdateParams &params
+) {
+    using V = typename Simd::V;
+
+    constexpr bool kForce = (kTerms & eUpdateForce) != 0;
+    constexpr bool kDrag = (kTerms & eUpdateDrag) != 0;
+    constexpr bool kGravity = (kTerms & eUpdateGravity) != 0;
+
+    const V zero = Simd::set1(0.0f);
+    const V half = Simd::set1(0.5f);
+    const V delta_time = Simd::set1(params.delta_time);
+    const uint32_t num_substeps = params.num_substeps > 1 ? params.num_substeps : 1;
+    [[maybe_unused]] const V drag = Simd::set1(params.drag);
+    // without force, 'force - velocity * drag' is 'velocity * -drag'
+    [[maybe_unused]] const V negative_drag = Simd::set1(-params.drag);
+    [[maybe_unused]] const V force[] = {
+        Simd::set1(params.force.x), Simd::set1(params.force.y), Simd::set1(params.force.z)
+    };
+    [[maybe_unused]] const V gravity = Simd::set1(-params.gravity);
+
+    uint32_t i = begin;
+    for (; i + Simd::kWidth <= end; i += Simd::kWidth) {
+        V life = Simd::load(fields.data[eFieldLife] + i);
+        [[maybe_unused]] V mass;
+        if constexpr (kForce || kDrag) {
+            mass = Simd::load(fields.data[eFieldMass] + i);
+        }
+        V position[3];
+        V velocity[3];
+        V acceleration[3];
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            position[axis] = Simd::load(fields.data[eFieldPositionX + axis] + i);
+            velocity[axis] = Simd::load(fields.data[eFieldVelocityX + axis] + i);
+            acceleration[axis] = Simd::load(fields.data[eFieldAccelerationX + axis] + i);
+        }
+
+        // all substeps stay in registers, particles are loaded and stored once
+        for (uint32_t substep = 0; substep < num_substeps; substep++) {
+            // dead lanes are computed anyway and masked out, instead of branching
+            auto alive = Simd::greater(life, zero);
+
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                V acceleration_new = zero;
+                if constexpr (kForce && kDrag) {
+                    acceleration_new = Simd::div(Simd::sub(force[axis], Simd::mul(velocity[axis], drag)), mass);
+                } else if constexpr (kForce) {
+                    acceleration_new = Simd::div(force[axis], mass);
+                } else if constexpr (kDrag) {
+                    acceleration_new = Simd::div(Simd::mul(velocity[axis], negative_drag), mass);
+                }
+                if (kGravity && axis == 1) {
+                    acceleration_new = Simd::add(acceleration_new, gravity);
+                }
+                V velocity_half = Simd::add(
+                    velocity[axis], Simd::mul(Simd::mul(acceleration[axis], delta_time), half)
+                );
+                V position_new = Simd::add(position[axis], Simd::mul(velocity_half, delta_time));
+                V velocity_new = Simd::add(
+                    velocity[axis],
+                    Simd::mul(Simd::mul(Simd::add(acceleration[axis], acceleration_new), delta_time), half)
+                );
+
+                position[axis] = Simd::select(alive, position_new, position[axis]);
+                velocity[axis] = Simd::select(alive, velocity_new, velocity[axis]);
+                acceleration[axis] = Simd::select(alive, acceleration_new, acceleration[axis]);
+            }
+            life = Simd::select(alive, Simd::sub(life, delta_time), life);
+        }
+
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            Simd::store(fields.data[eFieldPositionX + axis] + i, position[axis]);
+            Simd::store(fields.data[eFieldVelocityX + axis] + i, velocity[axis]);
+            Simd::store(fields.data[eFieldAccelerationX + axis] + i, acceleration[axis]);
+        }
+        Simd::store(fields.data[eFieldLife] + i, life);
+    }
+
+    if (i < end) {
+        get_update_kernel(eIsaScalar, kTerms)(fields, i, end, params);
+    }
+}
+
+// one instantiation per set of terms
+template <typename Simd>
+UpdateKernel get_update_kernel_simd(uint32_t terms) {
+    static constexpr UpdateKernel kKernels[eNumUpdateTermSets] = {
+        update_particles_simd<Simd, 0>,
+        update_particles_simd<Simd, 1>,
+        update_particles_simd<Simd, 2>,
+        update_particles_simd<Simd, 3>,
+        update_particles_simd<Simd, 4>,
+        update_particles_simd<Simd, 5>,
+        update_particles_simd<Simd, 6>,
+        update_particles_simd<Simd, 7>,
+    };
+    return kKernels[terms];
+}
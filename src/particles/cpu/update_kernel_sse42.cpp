@@ -0,0 +1,11 @@
+#include "update_kernel_simd.hpp"
+
+#if CPU_ISA_X86
+
+#include "simd_sse42.hpp"
+
+UpdateKernel get_update_kernel_sse42(uint32_t terms) {
+    return get_update_kernel_simd<Sse42>(terms);
+}
+
+#endif
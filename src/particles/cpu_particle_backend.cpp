@@ -0,0 +1,235 @@
+#include "cpu_particle_backend.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include <imgui.h>
+
+namespace {
+
+// particles per chunk of parallel stages, 16 KB of each field, so that the fields touched by a chunk stay in cache
+// it's a multiple of every SIMD width, chunks only have a scalar tail at the end of particles
+constexpr uint32_t kChunkSize = 16 * 1024 / sizeof(float);
+
+// adds the time of its scope to 'window'
+class ScopedTimer {
+public:
+    ScopedTimer(SampleWindow &window) : window_(window), begin_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - begin_;
+        window_.add(elapsed.count());
+    }
+
+private:
+    SampleWindow &window_;
+    std::chrono::steady_clock::time_point begin_;
+};
+
+}
+
+CpuParticleBackend::CpuParticleBackend(uint32_t max_num_particles) : max_num_particles_(max_num_particles) {
+    detected_isa_ = detect_cpu_isa();
+    set_isa(detected_isa_);
+    set_num_threads(0);
+}
+
+void CpuParticleBackend::set_isa(CpuIsa isa) {
+    isa_ = std::min(isa, detected_isa_);
+    emit_kernel_ = get_emit_kernel(isa_);
+}
+
+void CpuParticleBackend::set_num_threads(uint32_t num_threads) {
+    jobs_ = std::make_unique<JobSystem>(num_threads);
+    thread_indices_.assign(jobs_->num_threads(), std::vector<uint32_t>(kChunkSize));
+    thread_stats_counter_ = 0;
+    thread_stats_.clear();
+    thread_stats_parallel_ms_ = 0.0;
+}
+
+ParticleFields CpuParticleBackend::fields() {
+    ParticleFields fields;
+    for (uint32_t field = 0; field < eNumFields; field++) {
+        fields.data[field] = fields_[field].data();
+    }
+    return fields;
+}
+
+ParticleFields CpuParticleBackend::compacted_fields() {
+    ParticleFields fields;
+    for (uint32_t field = 0; field < eNumFields; field++) {
+        fields.data[field] = compacted_fields_[field].data();
+    }
+    return fields;
+}
+
+void CpuParticleBackend::resize_fields(uint32_t num_particles) {
+    for (auto &field : fields_) {
+        field.resize(num_particles);
+    }
+}
+
+void CpuParticleBackend::reset() {
+    num_particles_ = 0;
+}
+
+void CpuParticleBackend::emit(const ParticleEmitParams &params) {
+    ScopedTimer timer(stage_times_[eStageEmit]);
+
+    // same as 'emit_args.comp'
+    auto offset = num_particles_;
+    auto count = std::min(params.count, max_num_particles_ - offset);
+    stage_bytes_[eStageEmit] = uint64_t(count) * eNumFields * sizeof(float);
+    resize_fields(offset + count);
+    num_particles_ = offset + count;
+    auto fields = this->fields();
+    auto kernel_params = make_emit_kernel_params(params);
+
+    // every particle only depends on its index
+    jobs_->parallel_for(count, kChunkSize, [&](uint32_t begin, uint32_t end, uint32_t) {
+        emit_kernel_(fields, offset + begin, offset + end, kernel_params);
+    });
+}
+
+void CpuParticleBackend::update(const ParticleUpdateParams &params, bool compact) {
+    ScopedTimer timer(stage_times_[eStageUpdate]);
+
+    // every field but size is read and written, once whatever the number of substeps
+    stage_bytes_[eStageUpdate] = uint64_t(num_particles_) * 2 * (eNumFields - 1) * sizeof(float);
+
+    // specialized for the terms of this frame
+    auto update_kernel = get_update_kernel(isa_, get_update_terms(params));
+    auto fields = this->fields();
+    jobs_->parallel_for(num_particles_, kChunkSize, [&](uint32_t begin, uint32_t end, uint32_t) {
+        update_kernel(fields, begin, end, params);
+    });
+}
+
+void CpuParticleBackend::compact() {
+    ScopedTimer timer(stage_times_[eStageCompact]);
+
+    // every particle is assumed to survive, same as GPU, life is read by both passes
+    stage_bytes_[eStageCompact] = uint64_t(num_particles_) * (2 * eNumFields + 1) * sizeof(float);
+
+    // a first pass counts living particles of each chunk, the exclusive scan of counts is where chunks start,
+    // and a second pass copies them there, so that they keep their order like the scan based compaction on GPU
+    for (auto &field : compacted_fields_) {
+        field.resize(num_particles_);
+    }
+    auto fields = this->fields();
+    auto compacted_fields = this->compacted_fields();
+    uint32_t num_chunks = (num_particles_ + kChunkSize - 1) / kChunkSize;
+    chunk_offsets_.resize(num_chunks + 1);
+
+    jobs_->parallel_for(num_particles_, kChunkSize, [&](uint32_t begin, uint32_t end, uint32_t) {
+        const float *life = fields[eFieldLife];
+        uint32_t count = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            count += life[i] > 0.0f;
+        }
+        chunk_offsets_[begin / kChunkSize] = count;
+    });
+
+    // the last one is the number of living particles
+    chunk_offsets_[num_chunks] = 0;
+    std::exclusive_scan(chunk_offsets_.begin(), chunk_offsets_.end(), chunk_offsets_.begin(), 0u);
+
+    jobs_->parallel_for(num_particles_, kChunkSize, [&](uint32_t begin, uint32_t end, uint32_t thread) {
+        // indices of living particles, then every field is gathered without branches
+        const float *life = fields[eFieldLife];
+        uint32_t *indices = thread_indices_[thread].data();
+        uint32_t count = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            indices[count] = i;
+            count += life[i] > 0.0f;
+        }
+
+        uint32_t offset = chunk_offsets_[begin / kChunkSize];
+        for (uint32_t field = 0; field < eNumFields; field++) {
+            const float *src = fields[field];
+            float *dst = compacted_fields[field] + offset;
+            for (uint32_t i = 0; i < count; i++) {
+                dst[i] = src[indices[i]];
+            }
+        }
+    });
+
+    for (uint32_t field = 0; field < eNumFields; field++) {
+        std::swap(fields_[field], compacted_fields_[field]);
+    }
+    num_particles_ = chunk_offsets_[num_chunks];
+}
+
+void CpuParticleBackend::read_particles(std::vector<Particle> &particles) {
+    particles.resize(num_particles_);
+    auto fields = this->fields();
+    for (uint32_t i = 0; i < num_particles_; i++) {
+        auto &part = particles[i];
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            part.position[axis] = fields[eFieldPositionX + axis][i];
+            part.velocity[axis] = fields[eFieldVelocityX + axis][i];
+            part.acceleration[axis] = fields[eFieldAccelerationX + axis][i];
+        }
+        part.mass = fields[eFieldMass][i];
+        part.life = fields[eFieldLife][i];
+        part.size = fields[eFieldSize][i];
+    }
+}
+
+void CpuParticleBackend::end_frame() {
+    if (++thread_stats_counter_ < kThreadStatsFrames) {
+        return;
+    }
+    thread_stats_counter_ = 0;
+    thread_stats_ = jobs_->thread_stats();
+    thread_stats_parallel_ms_ = jobs_->parallel_ms();
+    jobs_->reset_stats();
+}
+
+CpuParticleBackend::StageStats CpuParticleBackend::stage_stats(uint32_t stage) const {
+    return { stage_times_[stage].stats(), stage_bytes_[stage] };
+}
+
+void CpuParticleBackend::draw_ui() {
+    ImGui::Text("capacity: %zu / %u", fields_[0].capacity(), max_num_particles_);
+
+    // only instruction sets supported by the CPU can be selected
+    const char *isa_names[eNumIsas];
+    for (uint32_t isa = 0; isa < eNumIsas; isa++) {
+        isa_names[isa] = cpu_isa_name(static_cast<CpuIsa>(isa));
+    }
+    int isa = isa_;
+    if (ImGui::Combo("instruction set", &isa, isa_names, detected_isa_ + 1)) {
+        set_isa(static_cast<CpuIsa>(isa));
+    }
+
+    int num_threads = jobs_->num_threads();
+    int max_num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (ImGui::SliderInt("threads", &num_threads, 1, std::max(max_num_threads, num_threads))) {
+        set_num_threads(num_threads);
+    }
+
+    // busy time of each thread over the time spent in parallel stages
+    auto table_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp;
+    if (!thread_stats_.empty() && ImGui::BeginTable("threads", 4, table_flags)) {
+        ImGui::TableSetupColumn("thread");
+        ImGui::TableSetupColumn("utilization");
+        ImGui::TableSetupColumn("chunks");
+        ImGui::TableSetupColumn("stolen");
+        ImGui::TableHeadersRow();
+        for (uint32_t thread = 0; thread < thread_stats_.size(); thread++) {
+            const auto &stats = thread_stats_[thread];
+            float utilization = thread_stats_parallel_ms_ > 0.0 ? stats.busy_ms / thread_stats_parallel_ms_ : 0.0f;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", thread);
+            ImGui::TableNextColumn();
+            ImGui::ProgressBar(utilization);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.num_chunks);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.num_stolen);
+        }
+        ImGui::EndTable();
+    }
+}
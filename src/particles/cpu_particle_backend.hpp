@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../utils/job_system.hpp"
+#include "particle_backend.hpp"
+#include "cpu/cpu_isa.hpp"
+#include "cpu/emit_kernel.hpp"
+#include "cpu/particle_fields.hpp"
+#include "cpu/update_kernel.hpp"
+
+// Reference simulation on CPU, following 'emit.comp', 'update.comp' and stream compaction.
+// It doesn't touch OpenGL, so it also runs without a window or a GPU.
+// Particles are stored as structure of arrays, and emitted and updated by SIMD kernels of the best instruction set
+// of the CPU.
+// Stages are split into chunks run in parallel by a job system.
+class CpuParticleBackend : public ParticleBackend {
+public:
+    CpuParticleBackend(uint32_t max_num_particles);
+
+    const char *name() const override { return "cpu"; }
+
+    void reset() override;
+    void emit(const ParticleEmitParams &params) override;
+    void update(const ParticleUpdateParams &params, bool compact) override;
+    void compact() override;
+
+    uint32_t num_particles() const override { return num_particles_; }
+    void read_particles(std::vector<Particle> &particles) override;
+
+    void end_frame() override;
+
+    StageStats stage_stats(uint32_t stage) const override;
+
+    void draw_ui() override;
+
+    // instruction set of kernels, up to the detected one
+    void set_isa(CpuIsa isa);
+    CpuIsa isa() const { return isa_; }
+
+    // threads running stages, including the calling one, 0 for one per hardware thread
+    void set_num_threads(uint32_t num_threads);
+    uint32_t num_threads() const { return jobs_->num_threads(); }
+
+private:
+    ParticleFields fields();
+    ParticleFields compacted_fields();
+    // resize every field, keeping the first 'num_particles_' particles
+    void resize_fields(uint32_t num_particles);
+
+    uint32_t max_num_particles_;
+    uint32_t num_particles_ = 0;
+    std::vector<float> fields_[eNumFields];
+    // target of compaction, swapped with 'fields_', so that it doesn't allocate once warmed up
+    std::vector<float> compacted_fields_[eNumFields];
+    // where each chunk starts in compacted fields
+    std::vector<uint32_t> chunk_offsets_;
+    // indices of living particles in a chunk being compacted, one per thread
+    std::vector<std::vector<uint32_t>> thread_indices_;
+
+    CpuIsa detected_isa_;
+    CpuIsa isa_;
+    EmitKernel emit_kernel_;
+
+    std::unique_ptr<JobSystem> jobs_;
+    // utilization of threads, accumulated over 'kThreadStatsFrames' frames
+    static constexpr uint32_t kThreadStatsFrames = 60;
+    uint32_t thread_stats_counter_ = 0;
+    std::vector<JobSystem::ThreadStats> thread_stats_;
+    double thread_stats_parallel_ms_ = 0.0;
+
+    SampleWindow stage_times_[eNumStages];
+    // estimated bytes read and written by each stage, the last time it was executed
+    uint64_t stage_bytes_[eNumStages] = {};
+};
@@ -0,0 +1,55 @@
+#include "gl_utils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include <cmrc/cmrc.hpp>
+#include <glad/glad.h>
+
+CMRC_DECLARE(shaders_spv);
+
+void resize_buffer(std::unique_ptr<GlBuffer> &buffer, uint64_t size, uint64_t copy_size, uint32_t usage) {
+    auto new_buffer = std::make_unique<GlBuffer>(size, usage);
+    if (buffer && copy_size > 0) {
+        glCopyNamedBufferSubData(buffer->id(), new_buffer->id(), 0, 0, copy_size);
+    }
+    buffer = std::move(new_buffer);
+}
+
+void bind_uniform_buffer(uint32_t binding, const GlBufferRange &range) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset, range.size);
+}
+
+void build_compute_program(
+    std::unique_ptr<GlComputeProgram> &program, const char *spv_path,
+    std::span<const GlSpecConstant> spec_constants
+) {
+    auto spv_file = cmrc::shaders_spv::get_filesystem().open(spv_path);
+    assert(spv_file.size() > 0 && spv_file.size() % 4 == 0);
+    std::vector<uint8_t> spv_data(spv_file.size());
+    std::copy(spv_file.begin(), spv_file.end(), spv_data.data());
+    GlShader shader(spv_data.data(), static_cast<uint32_t>(spv_file.size()), GL_COMPUTE_SHADER, spec_constants);
+    program = std::make_unique<GlComputeProgram>(shader);
+}
+
+void build_graphics_program(
+    std::unique_ptr<GlGraphicsProgram> &program, const char *vs_spv_path, const char *fs_spv_path,
+    std::span<const GlSpecConstant> vs_spec_constants
+) {
+    auto vs_spv_file = cmrc::shaders_spv::get_filesystem().open(vs_spv_path);
+    assert(vs_spv_file.size() > 0 && vs_spv_file.size() % 4 == 0);
+    std::vector<uint8_t> vs_spv_data(vs_spv_file.size());
+    std::copy(vs_spv_file.begin(), vs_spv_file.end(), vs_spv_data.data());
+    GlShader vs_shader(
+        vs_spv_data.data(), static_cast<uint32_t>(vs_spv_file.size()), GL_VERTEX_SHADER, vs_spec_constants
+    );
+    
+    auto fs_spv_file = cmrc::shaders_spv::get_filesystem().open(fs_spv_path);
+    assert(fs_spv_file.size() > 0 && fs_spv_file.size() % 4 == 0);
+    std::vector<uint8_t> fs_spv_data(fs_spv_file.size());
+    std::copy(fs_spv_file.begin(), fs_spv_file.end(), fs_spv_data.data());
+    GlShader fs_shader(fs_spv_data.data(), static_cast<uint32_t>(fs_spv_file.size()), GL_FRAGMENT_SHADER);
+
+    program = std::make_unique<GlGraphicsProgram>(vs_shader, fs_shader);
+}
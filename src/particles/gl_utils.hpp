@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+#include <span>
+
+#include "../glh/resource.hpp"
+#include "../glh/program.hpp"
+
+// replace 'buffer' by a new one of 'size' bytes, keeping its first 'copy_size' bytes
+void resize_buffer(std::unique_ptr<GlBuffer> &buffer, uint64_t size, uint64_t copy_size = 0, uint32_t usage = 0);
+
+void bind_uniform_buffer(uint32_t binding, const GlBufferRange &range);
+
+// programs are loaded from SPIR-V embedded by 'CMakeLists.txt'
+void build_compute_program(
+    std::unique_ptr<GlComputeProgram> &program, const char *spv_path,
+    std::span<const GlSpecConstant> spec_constants = {}
+);
+void build_graphics_program(
+    std::unique_ptr<GlGraphicsProgram> &program, const char *vs_spv_path, const char *fs_spv_path,
+    std::span<const GlSpecConstant> vs_spec_constants = {}
+);
@@ -0,0 +1,1168 @@
+#include "gpu_particle_backend.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <numeric>
+#include <string>
+
+#include <glad/glad.h>
+#include <imgui.h>
+
+#include "gl_utils.hpp"
+
+namespace {
+
+constexpr uint32_t kScanWidth = 512;
+// see 'state.glsl'
+constexpr uint32_t kMaxScanLevels = 4;
+// buffers start at this capacity and grow geometrically on demand
+constexpr uint32_t kInitialCapacity = 64 * 1024;
+
+// see 'particle.glsl'
+struct PackedParticle {
+    glm::vec3 position;
+    uint32_t velocity_xy;
+    uint32_t velocity_z_mass;
+    uint32_t size_life;
+};
+static_assert(sizeof(PackedParticle) == 24);
+
+// streams of structure of arrays layout, see 'particle.glsl'
+enum ParticleStream : uint32_t {
+    eStreamPositionSize,
+    eStreamVelocityMass,
+    eStreamAcceleration,
+    eStreamLife,
+};
+constexpr uint32_t kStreamSizes[] = { sizeof(glm::vec4), sizeof(glm::vec4), sizeof(glm::vec4), sizeof(float) };
+constexpr uint32_t kParticleStreamBinding = 16;
+constexpr uint32_t kParticleNewStreamBinding = 20;
+constexpr uint32_t kAllStreams = (1u << eStreamPositionSize) | (1u << eStreamVelocityMass)
+    | (1u << eStreamAcceleration) | (1u << eStreamLife);
+
+struct alignas(16) ParticleEmissionSettings {
+    glm::vec3 position;
+    float position_radius;
+    glm::vec3 velocity;
+    float velocity_angle_cos;
+    float mass_min;
+    float mass_max;
+    float life_min;
+    float life_max;
+    float size_min;
+    float size_max;
+};
+struct EmitParams {
+    uint32_t count;
+    uint32_t seed;
+    uint32_t capacity;
+};
+
+struct GrowParams {
+    uint32_t old_capacity;
+    uint32_t new_capacity;
+};
+
+struct alignas(16) UpdateParams {
+    glm::vec3 force;
+    float delta_time;
+    float gravity;
+    float drag;
+};
+
+struct DispatchIndirectCommand {
+    uint32_t num_groups_x;
+    uint32_t num_groups_y;
+    uint32_t num_groups_z;
+};
+
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+struct DrawArraysIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first;
+    uint32_t base_instance;
+};
+
+// see 'state.glsl'
+struct ParticleState {
+    uint32_t num_particles;
+    uint32_t emit_offset;
+    uint32_t emit_count;
+    uint32_t _padding;
+    DispatchIndirectCommand emit_dispatch;
+    DispatchIndirectCommand update_dispatch;
+    DispatchIndirectCommand scan_dispatch[kMaxScanLevels];
+    DispatchIndirectCommand scan3_dispatch[kMaxScanLevels];
+};
+
+constexpr ParticleState kEmptyParticleState {
+    .emit_dispatch = { 0, 1, 1 },
+    .update_dispatch = { 0, 1, 1 },
+    .scan_dispatch = { { 0, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 } },
+    .scan3_dispatch = { { 0, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 }, { 0, 1, 1 } },
+};
+
+constexpr uint64_t scan_dispatch_offset(uint32_t level) {
+    return offsetof(ParticleState, scan_dispatch) + level * sizeof(DispatchIndirectCommand);
+}
+
+constexpr uint64_t scan3_dispatch_offset(uint32_t level) {
+    return offsetof(ParticleState, scan3_dispatch) + level * sizeof(DispatchIndirectCommand);
+}
+
+struct ScanParams {
+    uint32_t level;
+    uint32_t top;
+};
+
+// see 'sort.glsl'
+constexpr uint32_t kSortKeyBits = 24;
+constexpr uint32_t kSortRadixBits = 4;
+constexpr uint32_t kSortRadix = 1u << kSortRadixBits;
+constexpr uint32_t kSortBlockSize = 2048;
+constexpr uint32_t kNumSortPasses = kSortKeyBits / kSortRadixBits;
+// sorted keys end up in the buffers they started from
+static_assert(kNumSortPasses % 2 == 0);
+
+struct SortState {
+    uint32_t num_keys;
+    uint32_t num_blocks;
+    DispatchIndirectCommand block_dispatch;
+};
+
+constexpr SortState kEmptySortState {
+    .block_dispatch = { 0, 1, 1 },
+};
+
+// see 'state.glsl'
+struct DrawArgs {
+    DrawElementsIndirectCommand billboard_draw;
+    DrawArraysIndirectCommand pulled_draw;
+    DrawArraysIndirectCommand point_draw;
+};
+
+// 'draw_args.comp' reads the count of either state
+static_assert(offsetof(ParticleState, num_particles) == 0 && offsetof(SortState, num_keys) == 0);
+
+struct DrawArgsParams {
+    uint32_t billboard_num_indices;
+    uint32_t draw_points;
+};
+
+struct SortPassParams {
+    uint32_t shift;
+};
+
+struct LodParams {
+    float viewport_height;
+    float point_threshold;
+};
+
+uint32_t div_ceil(uint32_t a, uint32_t b) {
+    return (a + b - 1) / b;
+}
+
+// number of levels of the three-pass scan, each level scans block sums of the previous one,
+// until the top level fits in a single workgroup
+uint32_t num_scan_levels(uint32_t capacity) {
+    uint32_t num_levels = 2;
+    for (uint32_t size = div_ceil(capacity, kScanWidth); size > kScanWidth; size = div_ceil(size, kScanWidth)) {
+        ++num_levels;
+    }
+    return num_levels;
+}
+
+// subgroup variants of scan kernels need arithmetic and ballot subgroup operations in compute shaders
+bool support_subgroup_scan() {
+    if (!GLAD_GL_KHR_shader_subgroup) {
+        return false;
+    }
+    int stages = 0;
+    int features = 0;
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+    const int required_features = GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR | GL_SUBGROUP_FEATURE_BALLOT_BIT_KHR;
+    return (stages & GL_COMPUTE_SHADER_BIT) != 0 && (features & required_features) == required_features;
+}
+
+// half in the low 16 bits of 'bits' to float, same as 'unpackHalf2x16' of GLSL
+float unpack_half(uint32_t bits) {
+    uint32_t sign = (bits & 0x8000u) << 16;
+    uint32_t exponent = (bits >> 10) & 0x1fu;
+    uint32_t mantissa = bits & 0x3ffu;
+    if (exponent == 0x1fu) {
+        // infinity or NaN
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    }
+    if (exponent == 0) {
+        // zero or denormal, exact in float
+        return std::bit_cast<float>(sign | std::bit_cast<uint32_t>(static_cast<float>(mantissa) * 0x1p-24f));
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// same as 'unpack_particle' of 'particle.glsl'
+Particle unpack_particle(const PackedParticle &data) {
+    Particle part;
+    part.position = data.position;
+    part.velocity = glm::vec3(
+        unpack_half(data.velocity_xy), unpack_half(data.velocity_xy >> 16), unpack_half(data.velocity_z_mass)
+    );
+    part.mass = unpack_half(data.velocity_z_mass >> 16);
+    part.acceleration = glm::vec3(0.0f);
+    part.size = unpack_half(data.size_life);
+    part.life = static_cast<float>(data.size_life >> 16) / 65535.0f * GpuParticleBackend::kPackedLifeRange;
+    return part;
+}
+
+template <typename T>
+std::vector<T> read_buffer(const GlBuffer &buffer, uint32_t count) {
+    std::vector<T> data(count);
+    glGetNamedBufferSubData(buffer.id(), 0, count * sizeof(T), data.data());
+    return data;
+}
+
+}
+
+GpuParticleBackend::GpuParticleBackend(GlUploadRing &upload_ring, uint32_t max_num_particles)
+    : upload_ring_(upload_ring), max_num_particles_(max_num_particles) {
+    particles_state_buffer_[0] = std::make_unique<GlBuffer>(sizeof(ParticleState), GL_DYNAMIC_STORAGE_BIT);
+    particles_state_buffer_[1] = std::make_unique<GlBuffer>(sizeof(ParticleState), GL_DYNAMIC_STORAGE_BIT);
+    num_particles_readback_buffer_ = std::make_unique<GlBuffer>(sizeof(uint32_t), GL_MAP_READ_BIT);
+    visible_state_buffer_ = std::make_unique<GlBuffer>(sizeof(ParticleState));
+    point_state_buffer_ = std::make_unique<GlBuffer>(sizeof(ParticleState));
+    sort_state_buffer_ = std::make_unique<GlBuffer>(sizeof(SortState), GL_DYNAMIC_STORAGE_BIT);
+    draw_args_buffer_ = std::make_unique<GlBuffer>(sizeof(DrawArgs));
+
+    use_subgroup_scan_ = support_subgroup_scan();
+    build_programs();
+    grow(std::min(kInitialCapacity, max_num_particles_));
+    reset();
+}
+
+GpuParticleBackend::~GpuParticleBackend() {
+    if (num_particles_fence_) {
+        glDeleteSync(num_particles_fence_);
+    }
+}
+
+void GpuParticleBackend::set_allocation_mode(AllocationMode mode) {
+    if (allocation_mode_ != mode) {
+        allocation_mode_ = mode;
+        build_programs();
+        reset();
+    }
+}
+
+void GpuParticleBackend::set_particle_layout(ParticleLayout layout) {
+    if (particle_layout_ != layout) {
+        particle_layout_ = layout;
+        // contents are dropped by reset anyway
+        resize_particle_buffers(0, capacity_);
+        build_programs();
+        reset();
+    }
+}
+
+uint32_t GpuParticleBackend::particle_stream_size(uint32_t stream) const {
+    switch (particle_layout_) {
+        case eLayoutFull:
+            return stream == 0 ? sizeof(Particle) : 0;
+        case eLayoutPacked:
+            return stream == 0 ? sizeof(PackedParticle) : 0;
+        case eLayoutSoA:
+            return kStreamSizes[stream];
+    }
+    return 0;
+}
+
+GpuParticleBackend::ParticleFootprint GpuParticleBackend::particle_footprint() const {
+    uint32_t size = 0;
+    for (uint32_t stream = 0; stream < kNumParticleStreams; stream++) {
+        size += particle_stream_size(stream);
+    }
+    if (particle_layout_ == eLayoutSoA) {
+        return { size, kStreamSizes[eStreamLife], kStreamSizes[eStreamPositionSize] + kStreamSizes[eStreamLife] };
+    }
+    // the whole particle is loaded anyway
+    return { size, size, size };
+}
+
+void GpuParticleBackend::resize_particle_buffers(uint32_t old_capacity, uint32_t capacity) {
+    // only the current buffers hold live data, the other side of the ping-pong is rewritten before being read
+    auto curr_particles = particles_buffer_index();
+    for (uint32_t stream = 0; stream < kNumParticleStreams; stream++) {
+        auto stream_size = particle_stream_size(stream);
+        if (stream_size == 0) {
+            particles_buffer_[0][stream].reset();
+            particles_buffer_[1][stream].reset();
+            continue;
+        }
+        resize_buffer(particles_buffer_[curr_particles][stream], capacity * stream_size, old_capacity * stream_size);
+        resize_buffer(particles_buffer_[curr_particles ^ 1][stream], capacity * stream_size);
+    }
+}
+
+void GpuParticleBackend::bind_particles(uint32_t index, uint32_t binding, uint32_t stream_binding, uint32_t streams) {
+    if (particle_layout_ != eLayoutSoA) {
+        uint32_t buffer = particles_buffer_[index][0]->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, binding, 1, &buffer);
+        return;
+    }
+    for (uint32_t stream = 0; stream < kNumParticleStreams; stream++) {
+        if ((streams & (1u << stream)) != 0) {
+            uint32_t buffer = particles_buffer_[index][stream]->id();
+            glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, stream_binding + stream, 1, &buffer);
+        }
+    }
+}
+
+void GpuParticleBackend::reset() {
+    glNamedBufferSubData(particles_state_buffer_[0]->id(), 0, sizeof(ParticleState), &kEmptyParticleState);
+    glNamedBufferSubData(particles_state_buffer_[1]->id(), 0, sizeof(ParticleState), &kEmptyParticleState);
+    curr_particles_index_ = 0;
+    num_particles_bound_ = 0;
+    num_emitted_since_readback_ = 0;
+    depth_order_valid_ = false;
+
+    if (allocation_mode_ == eAllocationDeadList) {
+        // every slot is free, stored reversely so that slots are popped in increasing order
+        std::vector<uint32_t> dead_list(capacity_ + 1);
+        dead_list[0] = capacity_;
+        for (uint32_t i = 0; i < capacity_; i++) {
+            dead_list[i + 1] = capacity_ - 1 - i;
+        }
+        glNamedBufferSubData(dead_list_buffer_->id(), 0, dead_list.size() * sizeof(uint32_t), dead_list.data());
+    }
+}
+
+void GpuParticleBackend::build_programs() {
+    // variants by particle layout and by scan implementation, see 'CMakeLists.txt'
+    const char *layout_prefixes[] = { "", "packed/", "soa/" };
+    std::string layout_prefix = layout_prefixes[particle_layout_];
+    std::string subgroup_dir = use_subgroup_scan_ ? "subgroup/particle/" : "particle/";
+    std::string layout_dir = layout_prefix + "particle/";
+    std::string scan_dir = layout_prefix + subgroup_dir;
+    const GlSpecConstant dead_list_spec[] = {
+        { 0, allocation_mode_ == eAllocationDeadList },
+    };
+    const GlSpecConstant update_scan_spec[] = {
+        { 0, allocation_mode_ == eAllocationDeadList },
+        { 1, true },
+    };
+
+    build_compute_program(emit_program_, (layout_dir + "emit.comp.spv").c_str(), dead_list_spec);
+    build_compute_program(emit_args_program_, "particle/emit_args.comp.spv", dead_list_spec);
+    build_compute_program(dead_list_grow_program_, "particle/dead_list_grow.comp.spv");
+
+    build_compute_program(update_program_, (layout_dir + "update.comp.spv").c_str(), dead_list_spec);
+    build_compute_program(update_scan_program_, (scan_dir + "update.comp.spv").c_str(), update_scan_spec);
+    build_compute_program(alive_args_program_, "particle/alive_args.comp.spv");
+
+    build_compute_program(compact_program_, (layout_dir + "compact.comp.spv").c_str());
+    build_compute_program(scan1_program_, (scan_dir + "scan1.comp.spv").c_str());
+    build_compute_program(scan2_program_, (subgroup_dir + "scan2.comp.spv").c_str());
+    build_compute_program(scan3_program_, "particle/scan3.comp.spv");
+    build_compute_program(compact_onepass_program_, (scan_dir + "compact_onepass.comp.spv").c_str());
+
+    for (uint32_t cull = 0; cull < 2; cull++) {
+        for (uint32_t point_lod = 0; point_lod < 2; point_lod++) {
+            const GlSpecConstant cull_spec[] = {
+                { 0, allocation_mode_ == eAllocationDeadList },
+                { 1, cull != 0 },
+                { 2, point_lod != 0 },
+            };
+            build_compute_program(cull_programs_[cull][point_lod], (scan_dir + "cull.comp.spv").c_str(), cull_spec);
+        }
+    }
+
+    const GlSpecConstant indices_specs[2][1] = { { { 0, false } }, { { 0, true } } };
+    for (uint32_t use_indices = 0; use_indices < 2; use_indices++) {
+        build_compute_program(
+            sort_keys_programs_[use_indices], (layout_dir + "sort_keys.comp.spv").c_str(), indices_specs[use_indices]
+        );
+    }
+    build_compute_program(sort_count_program_, "particle/sort_count.comp.spv");
+    build_compute_program(sort_scan_program_, (subgroup_dir + "sort_scan.comp.spv").c_str());
+    build_compute_program(sort_scatter_program_, (subgroup_dir + "sort_scatter.comp.spv").c_str());
+
+    build_compute_program(draw_args_program_, "particle/draw_args.comp.spv");
+}
+
+void GpuParticleBackend::reserve(uint32_t num_particles) {
+    num_particles = std::min(num_particles, max_num_particles_);
+    if (num_particles > capacity_) {
+        uint64_t doubled = uint64_t(capacity_) * 2;
+        grow(static_cast<uint32_t>(std::clamp<uint64_t>(doubled, num_particles, max_num_particles_)));
+    }
+}
+
+void GpuParticleBackend::grow(uint32_t capacity) {
+    assert(capacity > capacity_ && capacity <= max_num_particles_);
+    auto old_capacity = capacity_;
+    capacity_ = capacity;
+
+    // make previous shader writes visible to the copies
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    resize_particle_buffers(old_capacity, capacity);
+    // only the current alive list holds live data
+    resize_buffer(
+        alive_indices_buffer_[curr_particles_index_], capacity * sizeof(uint32_t), old_capacity * sizeof(uint32_t)
+    );
+    resize_buffer(alive_indices_buffer_[curr_particles_index_ ^ 1], capacity * sizeof(uint32_t));
+    // count, followed by slots
+    resize_buffer(
+        dead_list_buffer_, (capacity + 1) * sizeof(uint32_t), (old_capacity + 1) * sizeof(uint32_t),
+        GL_DYNAMIC_STORAGE_BIT
+    );
+
+    // scan levels are scratch, level 0 holds the indices of compacted particles
+    scan_buffers_.resize(num_scan_levels(capacity));
+    uint32_t level_size = capacity;
+    for (auto &scan_buffer : scan_buffers_) {
+        resize_buffer(scan_buffer, level_size * sizeof(uint32_t));
+        level_size = div_ceil(level_size, kScanWidth);
+    }
+    // block counter, followed by status of each block
+    resize_buffer(block_status_buffer_, (div_ceil(capacity, kScanWidth) + 1) * sizeof(uint32_t));
+
+    // new slots are free in dead list mode
+    if (allocation_mode_ == eAllocationDeadList && old_capacity > 0) {
+        GlBufferRange params_range;
+        {
+            auto data = upload_ring_.typed_allocate<GrowParams>(params_range);
+            data->old_capacity = old_capacity;
+            data->new_capacity = capacity;
+        }
+
+        glUseProgram(dead_list_grow_program_->id());
+        uint32_t buffer = dead_list_buffer_->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, &buffer);
+        bind_uniform_buffer(1, params_range);
+
+        glDispatchCompute(div_ceil(capacity - old_capacity, 256), 1, 1);
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+void GpuParticleBackend::draw_ui() {
+    ImGui::Text("capacity: %u / %u", capacity_, max_num_particles_);
+    ImGui::Text("scan: %s", use_subgroup_scan_ ? "subgroup" : "blelloch");
+
+    const char *allocation_modes[] = { "compact", "dead list" };
+    int allocation_mode = allocation_mode_;
+    if (ImGui::Combo("allocation", &allocation_mode, allocation_modes, IM_ARRAYSIZE(allocation_modes))) {
+        set_allocation_mode(static_cast<AllocationMode>(allocation_mode));
+    }
+    const char *particle_layouts[] = { "full (48 bytes)", "packed (24 bytes)", "structure of arrays (52 bytes)" };
+    int particle_layout = particle_layout_;
+    if (ImGui::Combo("layout", &particle_layout, particle_layouts, IM_ARRAYSIZE(particle_layouts))) {
+        set_particle_layout(static_cast<ParticleLayout>(particle_layout));
+    }
+    const char *compact_modes[] = { "three-pass", "single-pass" };
+    int compact_mode = compact_mode_;
+    if (ImGui::Combo("compaction", &compact_mode, compact_modes, IM_ARRAYSIZE(compact_modes))) {
+        set_compact_mode(static_cast<CompactMode>(compact_mode));
+    }
+    ImGui::Checkbox("fuse update and scan", &fuse_update_scan_);
+    bool frustum_cull = frustum_cull_;
+    if (ImGui::Checkbox("frustum cull", &frustum_cull)) {
+        set_frustum_cull(frustum_cull);
+    }
+    bool point_lod = point_lod_;
+    if (ImGui::Checkbox("points below threshold", &point_lod)) {
+        set_point_lod(point_lod);
+    }
+    if (point_lod_) {
+        float point_threshold = point_threshold_;
+        if (ImGui::SliderFloat("point threshold", &point_threshold, 0.1f, 8.0f, "%.1f px")) {
+            set_point_threshold(point_threshold);
+        }
+    }
+
+    const char *depth_sort_modes[] = { "off", "every frame", "lazy" };
+    int depth_sort_mode = depth_sort_mode_;
+    if (ImGui::Combo("depth sort", &depth_sort_mode, depth_sort_modes, IM_ARRAYSIZE(depth_sort_modes))) {
+        set_depth_sort_mode(static_cast<DepthSortMode>(depth_sort_mode));
+    }
+    if (depth_sort_mode_ == eDepthSortLazy) {
+        int interval = depth_sort_interval_;
+        if (ImGui::SliderInt("sort interval", &interval, 1, 60)) {
+            set_depth_sort_interval(interval);
+        }
+    }
+}
+
+GpuParticleBackend::StageStats GpuParticleBackend::stage_stats(uint32_t stage) const {
+    return { profiler_.stats(stage), stage_bytes_[stage] };
+}
+
+void GpuParticleBackend::emit(const ParticleEmitParams &params) {
+    if (params.count == 0) {
+        return;
+    }
+
+    profiler_.begin(eStageEmit);
+
+    stage_bytes_[eStageEmit] = uint64_t(params.count) * particle_footprint().full;
+
+    // particles on GPU never exceed the bound, so emission can't be clamped by capacity before reaching the maximum
+    reserve(num_particles_bound_ + params.count);
+    num_particles_bound_ = std::min(num_particles_bound_ + params.count, capacity_);
+    num_emitted_since_readback_ += params.count;
+    depth_order_valid_ = false;
+
+    GlBufferRange settings_range;
+    {
+        auto data = upload_ring_.typed_allocate<ParticleEmissionSettings>(settings_range);
+        data->position = params.position;
+        data->position_radius = params.position_radius;
+        data->velocity = params.velocity;
+        data->velocity_angle_cos = params.velocity_angle_cos;
+        data->life_min = params.life_min;
+        data->life_max = params.life_max;
+        data->mass_min = params.mass_min;
+        data->mass_max = params.mass_max;
+        data->size_min = params.size_min;
+        data->size_max = params.size_max;
+    }
+
+    GlBufferRange params_range;
+    {
+        auto data = upload_ring_.typed_allocate<EmitParams>(params_range);
+        data->count = params.count;
+        data->seed = params.seed;
+        data->capacity = capacity_;
+    }
+
+    // clamp emitted count and bump number of particles on GPU
+    {
+        glUseProgram(emit_args_program_->id());
+        uint32_t buffers[] = {
+            particles_state_buffer_[curr_particles_index_]->id(),
+            dead_list_buffer_->id(),
+        };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, buffers);
+        bind_uniform_buffer(1, params_range);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 1, buffers + 1);
+
+        glDispatchCompute(1, 1, 1);
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    glUseProgram(emit_program_->id());
+    uint32_t buffers[] = {
+        particles_state_buffer_[curr_particles_index_]->id(),
+        alive_indices_buffer_[curr_particles_index_]->id(),
+        dead_list_buffer_->id(),
+    };
+    bind_particles(particles_buffer_index(), 0, kParticleStreamBinding, kAllStreams);
+    bind_uniform_buffer(1, settings_range);
+    bind_uniform_buffer(2, params_range);
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 3, 3, buffers);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, particles_state_buffer_[curr_particles_index_]->id());
+
+    glDispatchComputeIndirect(offsetof(ParticleState, emit_dispatch));
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    profiler_.end();
+}
+
+void GpuParticleBackend::update(const ParticleUpdateParams &params, bool compact) {
+    // the fused update kernel produces the output of 'scan1.comp', which is only used by three-pass compaction
+    auto use_dead_list = allocation_mode_ == eAllocationDeadList;
+    scan_fused_ = compact && !use_dead_list && fuse_update_scan_ && compact_mode_ == eCompactThreePass;
+    auto num_substeps = std::max(params.num_substeps, 1u);
+
+    profiler_.begin(eStageUpdate);
+
+    GlBufferRange params_range;
+    {
+        auto data = upload_ring_.typed_allocate<UpdateParams>(params_range);
+        data->delta_time = params.delta_time;
+        data->force = params.force;
+        data->gravity = params.gravity;
+        data->drag = params.drag;
+    }
+
+    // every particle is assumed to be alive, dead list mode also reads and writes alive lists
+    auto footprint = particle_footprint();
+    uint64_t bytes = 2 * footprint.full;
+    bytes += use_dead_list ? 2 * sizeof(uint32_t) : 0;
+    stage_bytes_[eStageUpdate] = num_particles_ * (num_substeps * bytes + (scan_fused_ ? sizeof(uint32_t) : 0));
+
+    // substeps are dispatched back to back within the frame, each one waits for the previous one
+    for (uint32_t substep = 0; substep < num_substeps; substep++) {
+        // only the last substep decides which particles survive compaction
+        bool fuse_scan = scan_fused_ && substep + 1 == num_substeps;
+
+        if (use_dead_list) {
+            // update.comp appends survivors to the other alive list, start it empty
+            uint32_t zero = 0;
+            glClearNamedBufferSubData(
+                particles_state_buffer_[curr_particles_index_ ^ 1]->id(), GL_R32UI,
+                offsetof(ParticleState, num_particles), sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero
+            );
+        }
+
+        glUseProgram(fuse_scan ? update_scan_program_->id() : update_program_->id());
+        uint32_t buffers[] = {
+            particles_state_buffer_[curr_particles_index_]->id(),
+            alive_indices_buffer_[curr_particles_index_]->id(),
+            alive_indices_buffer_[curr_particles_index_ ^ 1]->id(),
+            particles_state_buffer_[curr_particles_index_ ^ 1]->id(),
+            dead_list_buffer_->id(),
+            scan_buffers_[0]->id(),
+            scan_buffers_[1]->id(),
+        };
+        bind_particles(particles_buffer_index(), 0, kParticleStreamBinding, kAllStreams);
+        bind_uniform_buffer(1, params_range);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 7, buffers);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, particles_state_buffer_[curr_particles_index_]->id());
+
+        glDispatchComputeIndirect(offsetof(ParticleState, update_dispatch));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        if (use_dead_list) {
+            glUseProgram(alive_args_program_->id());
+            uint32_t state_buffer = particles_state_buffer_[curr_particles_index_ ^ 1]->id();
+            glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, &state_buffer);
+
+            glDispatchCompute(1, 1, 1);
+
+            curr_particles_index_ ^= 1;
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+        }
+    }
+
+    profiler_.end();
+}
+
+void GpuParticleBackend::compact() {
+    // dead particles are already dropped from the alive list by update
+    if (allocation_mode_ == eAllocationDeadList) {
+        return;
+    }
+
+    if (compact_mode_ == eCompactSinglePass) {
+        profiler_.begin(eStageCompact);
+        do_compact_single_pass();
+        profiler_.end();
+    } else {
+        do_compact_three_pass(scan_fused_);
+    }
+    scan_fused_ = false;
+
+    curr_particles_index_ ^= 1;
+    depth_order_valid_ = false;
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void GpuParticleBackend::do_compact_three_pass(bool skip_scan1) {
+    auto state_buffer = particles_state_buffer_[curr_particles_index_]->id();
+    auto new_state_buffer = particles_state_buffer_[curr_particles_index_ ^ 1]->id();
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state_buffer);
+
+    // every particle is assumed to survive
+    auto footprint = particle_footprint();
+    uint64_t num_block_sums = 0;
+    for (uint32_t size = div_ceil(num_particles_, kScanWidth); size > 1; size = div_ceil(size, kScanWidth)) {
+        num_block_sums += size;
+    }
+
+    // scan 1, may be already done by the fused update kernel
+    if (!skip_scan1) {
+        stage_bytes_[eStageScan1] = num_particles_ * uint64_t(footprint.life + sizeof(uint32_t));
+        profiler_.begin(eStageScan1);
+
+        glUseProgram(scan1_program_->id());
+        uint32_t buffers[] = {
+            scan_buffers_[0]->id(),
+            scan_buffers_[1]->id(),
+            state_buffer,
+        };
+        bind_particles(curr_particles_index_, 0, kParticleStreamBinding, 1u << eStreamLife);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 3, buffers);
+
+        glDispatchComputeIndirect(scan_dispatch_offset(0));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        profiler_.end();
+    }
+
+    // scan 2, for each level of block sums, the top level also writes state of the compacted array
+    stage_bytes_[eStageScan2] = 2 * num_block_sums * sizeof(uint32_t);
+    profiler_.begin(eStageScan2);
+
+    auto num_levels = static_cast<uint32_t>(scan_buffers_.size());
+    glUseProgram(scan2_program_->id());
+    for (uint32_t level = 1; level < num_levels; level++) {
+        bool top = level == num_levels - 1;
+        auto params_range = upload_ring_.upload(ScanParams { level, top });
+        uint32_t buffers[] = {
+            scan_buffers_[level]->id(),
+            scan_buffers_[top ? level : level + 1]->id(),
+            state_buffer,
+            new_state_buffer,
+        };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 4, buffers);
+        bind_uniform_buffer(4, params_range);
+
+        if (top) {
+            glDispatchCompute(1, 1, 1);
+        } else {
+            glDispatchComputeIndirect(scan_dispatch_offset(level));
+        }
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    profiler_.end();
+
+    // scan 3, from the top level down
+    stage_bytes_[eStageScan3] = 2 * (num_particles_ + num_block_sums) * sizeof(uint32_t);
+    profiler_.begin(eStageScan3);
+
+    glUseProgram(scan3_program_->id());
+    for (uint32_t level = num_levels - 1; level-- > 0;) {
+        auto params_range = upload_ring_.upload(ScanParams { level, false });
+        uint32_t buffers[] = {
+            scan_buffers_[level]->id(),
+            scan_buffers_[level + 1]->id(),
+            state_buffer,
+        };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 3, buffers);
+        bind_uniform_buffer(3, params_range);
+
+        glDispatchComputeIndirect(scan3_dispatch_offset(level));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    profiler_.end();
+
+    // compact
+    {
+        stage_bytes_[eStageCompact] = num_particles_ * uint64_t(sizeof(uint32_t) + 2 * footprint.full);
+        profiler_.begin(eStageCompact);
+
+        glUseProgram(compact_program_->id());
+        uint32_t indices_buffer = scan_buffers_[0]->id();
+        bind_particles(curr_particles_index_, 0, kParticleStreamBinding, kAllStreams);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 1, &indices_buffer);
+        bind_particles(curr_particles_index_ ^ 1, 2, kParticleNewStreamBinding, kAllStreams);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 3, 1, &state_buffer);
+
+        glDispatchComputeIndirect(scan_dispatch_offset(0));
+
+        profiler_.end();
+    }
+}
+
+void GpuParticleBackend::do_compact_single_pass() {
+    auto state_buffer = particles_state_buffer_[curr_particles_index_]->id();
+    auto new_state_buffer = particles_state_buffer_[curr_particles_index_ ^ 1]->id();
+
+    // every particle is assumed to survive
+    auto footprint = particle_footprint();
+    stage_bytes_[eStageCompact] = num_particles_ * uint64_t(footprint.life + 2 * footprint.full);
+
+    // no workgroup is launched when there is no particle, so start from an empty state
+    glNamedBufferSubData(new_state_buffer, 0, sizeof(ParticleState), &kEmptyParticleState);
+    uint32_t zero = 0;
+    glClearNamedBufferData(block_status_buffer_->id(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glUseProgram(compact_onepass_program_->id());
+    uint32_t buffers[] = {
+        state_buffer,
+        new_state_buffer,
+        block_status_buffer_->id(),
+    };
+    bind_particles(curr_particles_index_, 0, kParticleStreamBinding, kAllStreams);
+    bind_particles(curr_particles_index_ ^ 1, 1, kParticleNewStreamBinding, kAllStreams);
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 3, buffers);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state_buffer);
+
+    glDispatchComputeIndirect(scan_dispatch_offset(0));
+}
+
+void GpuParticleBackend::end_frame() {
+    read_num_particles();
+    // results of the frame slot about to be reused are read back here
+    profiler_.begin_frame();
+}
+
+void GpuParticleBackend::finish() {
+    glFinish();
+    profiler_.flush();
+    read_num_particles();
+}
+
+void GpuParticleBackend::set_depth_sort_mode(DepthSortMode mode) {
+    if (depth_sort_mode_ != mode) {
+        depth_sort_mode_ = mode;
+        depth_order_valid_ = false;
+    }
+}
+
+void GpuParticleBackend::set_frustum_cull(bool cull) {
+    if (frustum_cull_ != cull) {
+        frustum_cull_ = cull;
+        // the order only holds the visible set
+        depth_order_valid_ = false;
+    }
+}
+
+void GpuParticleBackend::set_point_lod(bool point_lod) {
+    if (point_lod_ != point_lod) {
+        point_lod_ = point_lod;
+        // the order only holds billboards
+        depth_order_valid_ = false;
+    }
+}
+
+void GpuParticleBackend::set_point_threshold(float pixels) {
+    if (point_threshold_ != pixels) {
+        point_threshold_ = pixels;
+        depth_order_valid_ = false;
+    }
+}
+
+void GpuParticleBackend::prepare_draw(
+    const GlBufferRange &camera_buffer, const glm::mat4 &view, uint32_t viewport_height
+) {
+    bool sort = depth_sort_mode_ != eDepthSortOff;
+    if (sort) {
+        frames_since_depth_sort_++;
+        if (depth_sort_mode_ == eDepthSortLazy && depth_order_valid_ && view == depth_sort_view_
+            && viewport_height == depth_sort_viewport_height_ && frames_since_depth_sort_ < depth_sort_interval_) {
+            do_draw_args();
+            return;
+        }
+    }
+
+    // the sort takes what is left after culling and split of points
+    uint32_t state_buffer = particles_state_buffer_[curr_particles_index_]->id();
+    uint32_t indices_buffer = alive_indices_buffer_[curr_particles_index_]->id();
+    bool use_indices = allocation_mode_ == eAllocationDeadList;
+    culled_ = frustum_cull_ || point_lod_;
+    points_split_ = point_lod_;
+    if (culled_) {
+        profiler_.begin(kDrawStageProfilerBase + eDrawStageCull);
+        do_cull(camera_buffer, viewport_height);
+        profiler_.end();
+
+        state_buffer = visible_state_buffer_->id();
+        indices_buffer = visible_indices_buffer_->id();
+        use_indices = true;
+    }
+
+    if (sort) {
+        frames_since_depth_sort_ = 0;
+        depth_sort_view_ = view;
+        depth_sort_viewport_height_ = viewport_height;
+        depth_order_valid_ = true;
+
+        profiler_.begin(kDrawStageProfilerBase + eDrawStageSort);
+        do_sort(camera_buffer, state_buffer, indices_buffer, use_indices);
+        profiler_.end();
+    }
+
+    do_draw_args();
+}
+
+GpuParticleBackend::StageStats GpuParticleBackend::draw_stage_stats(uint32_t stage) const {
+    return { profiler_.stats(kDrawStageProfilerBase + stage), draw_stage_bytes_[stage] };
+}
+
+void GpuParticleBackend::do_cull(const GlBufferRange &camera_buffer, uint32_t viewport_height) {
+    if (!visible_indices_buffer_ || visible_indices_buffer_->size() < capacity_ * sizeof(uint32_t)) {
+        resize_buffer(visible_indices_buffer_, capacity_ * sizeof(uint32_t));
+    }
+    if (points_split_ && (!point_indices_buffer_ || point_indices_buffer_->size() < capacity_ * sizeof(uint32_t))) {
+        resize_buffer(point_indices_buffer_, capacity_ * sizeof(uint32_t));
+    }
+
+    // every particle is assumed to be visible
+    auto use_dead_list = allocation_mode_ == eAllocationDeadList;
+    uint64_t bytes = particle_footprint().draw + (use_dead_list ? 2 : 1) * sizeof(uint32_t);
+    draw_stage_bytes_[eDrawStageCull] = num_particles_ * bytes;
+
+    // particles of both lists are counted by atomics
+    uint32_t zero = 0;
+    uint32_t num_lists = points_split_ ? 2 : 1;
+    uint32_t state_buffers[] = { visible_state_buffer_->id(), point_state_buffer_->id() };
+    for (uint32_t i = 0; i < num_lists; i++) {
+        glClearNamedBufferSubData(
+            state_buffers[i], GL_R32UI, offsetof(ParticleState, num_particles), sizeof(uint32_t),
+            GL_RED_INTEGER, GL_UNSIGNED_INT, &zero
+        );
+    }
+
+    auto state_buffer = particles_state_buffer_[curr_particles_index_]->id();
+    glUseProgram(cull_programs_[frustum_cull_][points_split_]->id());
+    uint32_t buffers[] = {
+        state_buffer,
+        alive_indices_buffer_[curr_particles_index_]->id(),
+        visible_indices_buffer_->id(),
+        visible_state_buffer_->id(),
+        points_split_ ? point_indices_buffer_->id() : 0,
+        point_state_buffer_->id(),
+    };
+    bind_particles(
+        particles_buffer_index(), 0, kParticleStreamBinding, (1u << eStreamPositionSize) | (1u << eStreamLife)
+    );
+    bind_uniform_buffer(1, camera_buffer);
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 2 + 2 * num_lists, buffers);
+    if (points_split_) {
+        bind_uniform_buffer(8, upload_ring_.upload(LodParams { float(viewport_height), point_threshold_ }));
+    }
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state_buffer);
+
+    glDispatchComputeIndirect(offsetof(ParticleState, update_dispatch));
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // the sort is dispatched from the visible list, points only need their count
+    glUseProgram(alive_args_program_->id());
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, &state_buffers[0]);
+
+    glDispatchCompute(1, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void GpuParticleBackend::do_sort(
+    const GlBufferRange &camera_buffer, uint32_t state_buffer, uint32_t indices_buffer, bool use_indices
+) {
+    // keys and values of a whole block are loaded at once, even past the last particle
+    uint32_t num_blocks = div_ceil(capacity_, kSortBlockSize);
+    uint64_t padded_size = uint64_t(num_blocks) * kSortBlockSize * sizeof(uint32_t);
+    if (!sort_keys_buffer_[0] || sort_keys_buffer_[0]->size() < padded_size) {
+        for (uint32_t i = 0; i < 2; i++) {
+            resize_buffer(sort_keys_buffer_[i], padded_size);
+            resize_buffer(sort_values_buffer_[i], padded_size);
+        }
+        resize_buffer(sort_histograms_buffer_, kSortRadix * num_blocks * sizeof(uint32_t));
+    }
+
+    // keys read positions and write keys and values, then each pass counts keys, and reads and writes both again.
+    // Every particle is assumed to be visible.
+    uint64_t key_bytes = particle_footprint().draw + (use_indices ? 3 : 2) * sizeof(uint32_t);
+    draw_stage_bytes_[eDrawStageSort] = num_particles_ * (key_bytes + kNumSortPasses * 5 * sizeof(uint32_t));
+
+    // no workgroup is launched when there is no particle, so start from an empty state
+    glNamedBufferSubData(sort_state_buffer_->id(), 0, sizeof(SortState), &kEmptySortState);
+
+    {
+        glUseProgram(sort_keys_programs_[use_indices]->id());
+        uint32_t buffers[] = {
+            state_buffer,
+            indices_buffer,
+            sort_keys_buffer_[0]->id(),
+            sort_values_buffer_[0]->id(),
+            sort_state_buffer_->id(),
+        };
+        bind_particles(particles_buffer_index(), 0, kParticleStreamBinding, 1u << eStreamPositionSize);
+        bind_uniform_buffer(1, camera_buffer);
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 2, 5, buffers);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, state_buffer);
+
+        glDispatchComputeIndirect(offsetof(ParticleState, update_dispatch));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, sort_state_buffer_->id());
+    for (uint32_t pass = 0; pass < kNumSortPasses; pass++) {
+        auto params_range = upload_ring_.upload(SortPassParams { pass * kSortRadixBits });
+        uint32_t keys = sort_keys_buffer_[pass % 2]->id();
+        uint32_t values = sort_values_buffer_[pass % 2]->id();
+        uint32_t new_keys = sort_keys_buffer_[(pass + 1) % 2]->id();
+        uint32_t new_values = sort_values_buffer_[(pass + 1) % 2]->id();
+        uint32_t histograms = sort_histograms_buffer_->id();
+        uint32_t sort_state = sort_state_buffer_->id();
+
+        glUseProgram(sort_count_program_->id());
+        uint32_t count_buffers[] = { keys, histograms, sort_state };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 3, count_buffers);
+        bind_uniform_buffer(3, params_range);
+
+        glDispatchComputeIndirect(offsetof(SortState, block_dispatch));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(sort_scan_program_->id());
+        uint32_t scan_buffers[] = { histograms, sort_state };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 2, scan_buffers);
+
+        glDispatchCompute(1, 1, 1);
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(sort_scatter_program_->id());
+        uint32_t scatter_buffers[] = { keys, values, new_keys, new_values, histograms, sort_state };
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 6, scatter_buffers);
+        bind_uniform_buffer(6, params_range);
+
+        glDispatchComputeIndirect(offsetof(SortState, block_dispatch));
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+void GpuParticleBackend::do_draw_args() {
+    // same list as 'bind_draw_buffers()'
+    uint32_t billboards_buffer = particles_state_buffer_[curr_particles_index_]->id();
+    if (depth_sorted()) {
+        billboards_buffer = sort_state_buffer_->id();
+    } else if (culled_) {
+        billboards_buffer = visible_state_buffer_->id();
+    }
+
+    glUseProgram(draw_args_program_->id());
+    uint32_t buffers[] = { billboards_buffer, point_state_buffer_->id(), draw_args_buffer_->id() };
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 3, buffers);
+    bind_uniform_buffer(3, upload_ring_.upload(DrawArgsParams { billboard_num_indices_, points_split_ }));
+
+    glDispatchCompute(1, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void GpuParticleBackend::bind_draw_buffers() {
+    bind_particles(
+        particles_buffer_index(), 0, kParticleStreamBinding, (1u << eStreamPositionSize) | (1u << eStreamLife)
+    );
+    if (depth_sorted()) {
+        uint32_t sorted_indices_buffer = sort_values_buffer_[0]->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 1, &sorted_indices_buffer);
+    } else if (culled_) {
+        uint32_t visible_indices_buffer = visible_indices_buffer_->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 1, &visible_indices_buffer);
+    } else {
+        uint32_t alive_indices_buffer = alive_indices_buffer_[curr_particles_index_]->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 1, &alive_indices_buffer);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_args_buffer_->id());
+}
+
+uint64_t GpuParticleBackend::draw_indirect_offset(bool pull_vertices) const {
+    return pull_vertices ? offsetof(DrawArgs, pulled_draw) : offsetof(DrawArgs, billboard_draw);
+}
+
+void GpuParticleBackend::bind_point_draw_buffers() {
+    bind_particles(
+        particles_buffer_index(), 0, kParticleStreamBinding, (1u << eStreamPositionSize) | (1u << eStreamLife)
+    );
+    uint32_t point_indices_buffer = point_indices_buffer_->id();
+    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 1, 1, &point_indices_buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_args_buffer_->id());
+}
+
+uint64_t GpuParticleBackend::point_draw_indirect_offset() const {
+    return offsetof(DrawArgs, point_draw);
+}
+
+uint32_t GpuParticleBackend::draw_footprint() const {
+    return particle_footprint().draw + (draw_uses_indices() ? sizeof(uint32_t) : 0);
+}
+
+void GpuParticleBackend::read_particles(std::vector<Particle> &particles) {
+    // make shader writes visible to the reads below, which wait for them
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    ParticleState state;
+    glGetNamedBufferSubData(particles_state_buffer_[curr_particles_index_]->id(), 0, sizeof(state), &state);
+    auto num_particles = state.num_particles;
+
+    // in dead list mode, particles are in the order of the alive list, otherwise slots are the order
+    std::vector<uint32_t> indices(num_particles);
+    uint32_t num_slots = num_particles;
+    if (allocation_mode_ == eAllocationDeadList) {
+        indices = read_buffer<uint32_t>(*alive_indices_buffer_[curr_particles_index_], num_particles);
+        num_slots = capacity_;
+    } else {
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+
+    particles.resize(num_particles);
+    const auto &buffers = particles_buffer_[particles_buffer_index()];
+    switch (particle_layout_) {
+        case eLayoutFull: {
+            auto data = read_buffer<Particle>(*buffers[0], num_slots);
+            for (uint32_t i = 0; i < num_particles; i++) {
+                particles[i] = data[indices[i]];
+            }
+            break;
+        }
+        case eLayoutPacked: {
+            auto data = read_buffer<PackedParticle>(*buffers[0], num_slots);
+            for (uint32_t i = 0; i < num_particles; i++) {
+                particles[i] = unpack_particle(data[indices[i]]);
+            }
+            break;
+        }
+        case eLayoutSoA: {
+            auto position_size = read_buffer<glm::vec4>(*buffers[eStreamPositionSize], num_slots);
+            auto velocity_mass = read_buffer<glm::vec4>(*buffers[eStreamVelocityMass], num_slots);
+            auto accelerations = read_buffer<glm::vec4>(*buffers[eStreamAcceleration], num_slots);
+            auto lives = read_buffer<float>(*buffers[eStreamLife], num_slots);
+            for (uint32_t i = 0; i < num_particles; i++) {
+                auto index = indices[i];
+                particles[i].position = glm::vec3(position_size[index]);
+                particles[i].size = position_size[index].w;
+                particles[i].velocity = glm::vec3(velocity_mass[index]);
+                particles[i].mass = velocity_mass[index].w;
+                particles[i].acceleration = glm::vec3(accelerations[index]);
+                particles[i].life = lives[index];
+            }
+            break;
+        }
+    }
+}
+
+void GpuParticleBackend::read_num_particles() {
+    // number of particles is only used by UI and for growing buffers, so it's read back asynchronously
+    // and may be a few frames late
+    if (num_particles_fence_) {
+        auto status = glClientWaitSync(num_particles_fence_, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+        glDeleteSync(num_particles_fence_);
+        num_particles_fence_ = nullptr;
+
+        auto data = num_particles_readback_buffer_->typed_map<uint32_t>();
+        num_particles_ = *data;
+        num_particles_readback_buffer_->unmap();
+
+        // tighten the bound with the count read back, plus everything emitted after it was copied
+        num_particles_bound_ = std::min(num_particles_ + num_emitted_since_readback_, capacity_);
+    }
+    num_emitted_since_readback_ = 0;
+
+    glCopyNamedBufferSubData(
+        particles_state_buffer_[curr_particles_index_]->id(), num_particles_readback_buffer_->id(),
+        offsetof(ParticleState, num_particles), 0, sizeof(uint32_t)
+    );
+    num_particles_fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
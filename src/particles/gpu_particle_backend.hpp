@@ -0,0 +1,260 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "particle_backend.hpp"
+#include "../glh/resource.hpp"
+#include "../glh/program.hpp"
+#include "../glh/profiler.hpp"
+
+// Simulation in OpenGL compute shaders. The number of particles never leaves GPU,
+// emission, update, compaction, sorting and drawing are driven by indirect arguments.
+class GpuParticleBackend : public ParticleBackend {
+public:
+    // buffers grow geometrically on demand, up to 'max_num_particles'
+    GpuParticleBackend(GlUploadRing &upload_ring, uint32_t max_num_particles);
+    ~GpuParticleBackend() override;
+
+    const char *name() const override { return "gpu"; }
+
+    void reset() override;
+    void emit(const ParticleEmitParams &params) override;
+    void update(const ParticleUpdateParams &params, bool compact) override;
+    void compact() override;
+    void end_frame() override;
+    void finish() override;
+
+    uint32_t num_particles() const override { return num_particles_; }
+    void read_particles(std::vector<Particle> &particles) override;
+
+    StageStats stage_stats(uint32_t stage) const override;
+
+    void draw_ui() override;
+
+    enum AllocationMode {
+        // dead particles are removed by stream compaction every 'compact_interval' frames
+        eAllocationCompact,
+        // slots of dead particles are pushed to a dead list and reused by emission, no compaction is needed
+        eAllocationDeadList,
+    };
+    void set_allocation_mode(AllocationMode mode);
+    AllocationMode allocation_mode() const { return allocation_mode_; }
+
+    enum ParticleLayout {
+        // 48 bytes per particle, integrated with velocity Verlet
+        eLayoutFull,
+        // 24 bytes per particle, half float velocity, mass and size, unorm16 life and no stored acceleration,
+        // integrated assuming constant acceleration over a time step
+        eLayoutPacked,
+        // same as full, stored as separate streams of position and size, velocity and mass, acceleration and life,
+        // so that each pass only touches the streams it needs
+        eLayoutSoA,
+    };
+    // seconds of life the packed layout stores, longer lives are cut to it, see 'particle.glsl'
+    static constexpr float kPackedLifeRange = 64.0f;
+    void set_particle_layout(ParticleLayout layout);
+    ParticleLayout particle_layout() const { return particle_layout_; }
+
+    enum CompactMode {
+        // scan1, scan2 and scan3 over as many levels of block sums as the capacity needs, and then compact
+        eCompactThreePass,
+        // flag, scan and scatter in one kernel, using chained scan with decoupled look-back
+        eCompactSinglePass,
+    };
+    void set_compact_mode(CompactMode mode) { compact_mode_ = mode; }
+
+    // whether update kernel also does the work of 'scan1.comp' on frames with three-pass compaction
+    void set_fuse_update_scan(bool fuse) { fuse_update_scan_ = fuse; }
+
+    enum DepthSortMode {
+        // drawn in the order of slots, or of the alive list in dead list mode
+        eDepthSortOff,
+        // sorted back to front every frame, for blending
+        eDepthSortEveryFrame,
+        // the last order is kept for up to 'depth_sort_interval' frames, and sorted again as soon as the camera
+        // moves, or particles are emitted or moved by compaction, which the order would miss.
+        // Particles dying meanwhile are drawn with zero size, the visible set is culled together with the order.
+        eDepthSortLazy,
+    };
+    void set_depth_sort_mode(DepthSortMode mode);
+    DepthSortMode depth_sort_mode() const { return depth_sort_mode_; }
+    void set_depth_sort_interval(uint32_t interval) { depth_sort_interval_ = interval; }
+
+    // whether only particles whose bounding sphere intersects the view frustum are drawn, see 'cull.comp'
+    void set_frustum_cull(bool cull);
+    bool frustum_cull() const { return frustum_cull_; }
+
+    // whether particles smaller on screen than 'point_threshold' pixels are drawn as points instead of billboards,
+    // see 'draw_point.vert'. They are split off by 'cull.comp', and aren't depth sorted.
+    void set_point_lod(bool point_lod);
+    bool point_lod() const { return point_lod_; }
+    void set_point_threshold(float pixels);
+
+    // indices of the triangles of a billboard, as a fan around its first vertex, see 'draw.vert'
+    void set_billboard_num_indices(uint32_t num_indices) { billboard_num_indices_ = num_indices; }
+
+    // culling and split of points, then radix sort by depth of the billboards left, as enabled, in the view of
+    // 'camera_buffer'. 'view' is its view matrix, which tells when the camera moves, 'viewport_height' is in pixels.
+    // Indirect draw arguments are derived from what is left. Once per frame, before drawing.
+    void prepare_draw(const GlBufferRange &camera_buffer, const glm::mat4 &view, uint32_t viewport_height);
+
+    // stages of 'prepare_draw()'
+    enum DrawStage {
+        eDrawStageCull,
+        eDrawStageSort,
+        eNumDrawStages,
+    };
+    static const char *draw_stage_name(uint32_t stage) {
+        const char *names[] = { "cull", "sort" };
+        return names[stage];
+    }
+    StageStats draw_stage_stats(uint32_t stage) const;
+
+    // binds particles for 'draw.vert' of the current layout, the index list if 'draw_uses_indices()'
+    // and the indirect draw arguments at 'draw_indirect_offset()' of GL_DRAW_INDIRECT_BUFFER.
+    // Arguments are for glDrawElementsIndirect, or glDrawArraysIndirect if 'pull_vertices'.
+    void bind_draw_buffers();
+    uint64_t draw_indirect_offset(bool pull_vertices) const;
+    // whether particles are drawn through the alive list, the visible list or the depth order
+    bool draw_uses_indices() const {
+        return depth_sorted() || culled_ || allocation_mode_ == eAllocationDeadList;
+    }
+    // bytes per particle read by 'draw.vert'
+    uint32_t draw_footprint() const;
+
+    // whether the last 'prepare_draw()' left particles to be drawn as points, by 'draw_point.vert'
+    // from the point list bound by 'bind_point_draw_buffers()', with arguments at 'point_draw_indirect_offset()'
+    bool draws_points() const { return points_split_; }
+    void bind_point_draw_buffers();
+    uint64_t point_draw_indirect_offset() const;
+
+private:
+    void build_programs();
+
+    // bytes per particle of each stream, 0 if the stream isn't used by the layout
+    uint32_t particle_stream_size(uint32_t stream) const;
+    // bytes per particle touched by a pass
+    struct ParticleFootprint {
+        uint32_t full;
+        // liveness test
+        uint32_t life;
+        uint32_t draw;
+    };
+    ParticleFootprint particle_footprint() const;
+    void resize_particle_buffers(uint32_t old_capacity, uint32_t capacity);
+    // binds particles at 'binding', or in structure of arrays layout,
+    // each stream of 'streams' at 'stream_binding' plus its index
+    void bind_particles(uint32_t index, uint32_t binding, uint32_t stream_binding, uint32_t streams);
+
+    // grow buffers if needed, so that 'num_particles' particles fit
+    void reserve(uint32_t num_particles);
+    void grow(uint32_t capacity);
+
+    bool depth_sorted() const { return depth_sort_mode_ != eDepthSortOff && depth_order_valid_; }
+    void do_cull(const GlBufferRange &camera_buffer, uint32_t viewport_height);
+    // sorts the 'state.num_particles' particles of 'state_buffer', through 'indices_buffer' if 'use_indices'
+    void do_sort(const GlBufferRange &camera_buffer, uint32_t state_buffer, uint32_t indices_buffer, bool use_indices);
+    void do_draw_args();
+
+    void do_compact_three_pass(bool skip_scan1);
+    void do_compact_single_pass();
+    void read_num_particles();
+
+    // in dead list mode, slots never move and only 'particles_buffer_[0]' is used
+    uint32_t particles_buffer_index() const {
+        return allocation_mode_ == eAllocationDeadList ? 0 : curr_particles_index_;
+    }
+
+    GlUploadRing &upload_ring_;
+
+    AllocationMode allocation_mode_ = eAllocationCompact;
+    ParticleLayout particle_layout_ = eLayoutFull;
+    CompactMode compact_mode_ = eCompactSinglePass;
+    bool use_subgroup_scan_ = false;
+    bool fuse_update_scan_ = true;
+    // whether the last update also did the work of 'scan1.comp'
+    bool scan_fused_ = false;
+
+    // number of particles read back from GPU, may be a few frames late
+    uint32_t num_particles_ = 0;
+    // upper bound of the number of particles on GPU, decides when buffers grow
+    uint32_t num_particles_bound_ = 0;
+    uint32_t num_emitted_since_readback_ = 0;
+    uint32_t max_num_particles_;
+    // estimated bytes read and written by each stage, the last time it was executed
+    uint64_t stage_bytes_[eNumStages] = {};
+    uint64_t draw_stage_bytes_[eNumDrawStages] = {};
+    // stages, followed by draw stages from this index
+    static constexpr uint32_t kDrawStageProfilerBase = eNumStages;
+    GlProfiler profiler_ { kDrawStageProfilerBase + eNumDrawStages };
+    uint32_t capacity_ = 0;
+    uint32_t curr_particles_index_ = 0;
+    // one buffer per stream, only the first one is used by array of structures layouts
+    static constexpr uint32_t kNumParticleStreams = 4;
+    std::unique_ptr<GlBuffer> particles_buffer_[2][kNumParticleStreams];
+    std::unique_ptr<GlBuffer> particles_state_buffer_[2];
+    std::unique_ptr<GlBuffer> num_particles_readback_buffer_;
+    GLsync num_particles_fence_ = nullptr;
+
+    std::unique_ptr<GlComputeProgram> emit_program_;
+    std::unique_ptr<GlComputeProgram> emit_args_program_;
+    std::unique_ptr<GlComputeProgram> dead_list_grow_program_;
+    std::unique_ptr<GlBuffer> dead_list_buffer_;
+
+    std::unique_ptr<GlComputeProgram> update_program_;
+    std::unique_ptr<GlComputeProgram> update_scan_program_;
+    std::unique_ptr<GlComputeProgram> alive_args_program_;
+    // alive list of dead list mode, ping-ponged together with 'particles_state_buffer_'
+    std::unique_ptr<GlBuffer> alive_indices_buffer_[2];
+
+    std::unique_ptr<GlComputeProgram> scan1_program_;
+    std::unique_ptr<GlComputeProgram> scan2_program_;
+    std::unique_ptr<GlComputeProgram> scan3_program_;
+    std::unique_ptr<GlComputeProgram> compact_program_;
+    // level 0 holds indices of compacted particles, level i block sums of level i - 1
+    std::vector<std::unique_ptr<GlBuffer>> scan_buffers_;
+    std::unique_ptr<GlComputeProgram> compact_onepass_program_;
+    std::unique_ptr<GlBuffer> block_status_buffer_;
+
+    bool frustum_cull_ = false;
+    bool point_lod_ = false;
+    float point_threshold_ = 1.0f;
+    // whether the last 'prepare_draw()' culled or split particles, billboards are drawn from the visible list
+    bool culled_ = false;
+    // whether the last 'prepare_draw()' split points off
+    bool points_split_ = false;
+    // indexed by whether particles are culled and whether points are split off
+    std::unique_ptr<GlComputeProgram> cull_programs_[2][2];
+    // visible particles, allocated on the first culling, with their count and indirect arguments
+    std::unique_ptr<GlBuffer> visible_indices_buffer_;
+    std::unique_ptr<GlBuffer> visible_state_buffer_;
+    // same for particles drawn as points
+    std::unique_ptr<GlBuffer> point_indices_buffer_;
+    std::unique_ptr<GlBuffer> point_state_buffer_;
+
+    DepthSortMode depth_sort_mode_ = eDepthSortOff;
+    uint32_t depth_sort_interval_ = 8;
+    // whether the last order still holds every particle at its slot
+    bool depth_order_valid_ = false;
+    uint32_t frames_since_depth_sort_ = 0;
+    glm::mat4 depth_sort_view_ = glm::mat4(1.0f);
+    uint32_t depth_sort_viewport_height_ = 0;
+    // indexed by whether keys are computed through an index list
+    std::unique_ptr<GlComputeProgram> sort_keys_programs_[2];
+    std::unique_ptr<GlComputeProgram> sort_count_program_;
+    std::unique_ptr<GlComputeProgram> sort_scan_program_;
+    std::unique_ptr<GlComputeProgram> sort_scatter_program_;
+    // keys and particle indices, ping-ponged by each pass, sorted ones end up in the first buffers.
+    // Allocated on the first sort, padded to whole blocks of the sort.
+    std::unique_ptr<GlBuffer> sort_keys_buffer_[2];
+    std::unique_ptr<GlBuffer> sort_values_buffer_[2];
+    std::unique_ptr<GlBuffer> sort_histograms_buffer_;
+    std::unique_ptr<GlBuffer> sort_state_buffer_;
+
+    uint32_t billboard_num_indices_ = 6;
+    std::unique_ptr<GlComputeProgram> draw_args_program_;
+    std::unique_ptr<GlBuffer> draw_args_buffer_;
+};
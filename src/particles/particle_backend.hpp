@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../utils/sample_window.hpp"
+
+// particle as seen by kernels, see 'particle.glsl'
+struct alignas(16) Particle {
+    glm::vec3 position;
+    float mass;
+    glm::vec3 velocity;
+    float life;
+    glm::vec3 acceleration;
+    float size;
+};
+static_assert(sizeof(Particle) == 48);
+
+// see 'emit.comp'
+struct ParticleEmitParams {
+    glm::vec3 position;
+    float position_radius;
+    glm::vec3 velocity;
+    float velocity_angle_cos;
+    float mass_min;
+    float mass_max;
+    float life_min;
+    float life_max;
+    float size_min;
+    float size_max;
+    // clamped by the capacity
+    uint32_t count;
+    uint32_t seed;
+};
+
+// see 'update.comp'
+struct ParticleUpdateParams {
+    glm::vec3 force;
+    // of each substep
+    float delta_time;
+    float gravity;
+    float drag;
+    // steps of 'delta_time' run by a single update, dead particles stop at the step where they die
+    uint32_t num_substeps = 1;
+};
+
+// Simulation of particles: emission, update and compaction of dead particles.
+// Every backend produces the same particles in the same order from the same input, drawing is left to the caller.
+class ParticleBackend {
+public:
+    virtual ~ParticleBackend() = default;
+
+    virtual const char *name() const = 0;
+
+    virtual void reset() = 0;
+
+    // emitted particles are appended after the existing ones
+    virtual void emit(const ParticleEmitParams &params) = 0;
+    // 'compact' tells whether 'compact()' follows, so that a backend can fuse work into the update
+    virtual void update(const ParticleUpdateParams &params, bool compact) = 0;
+    // remove dead particles, keeping the order of living ones
+    virtual void compact() = 0;
+    // once per frame, after the simulation
+    virtual void end_frame() {}
+    // waits for the simulation to finish, and for times of every stage executed so far
+    virtual void finish() {}
+
+    // may be a few frames late
+    virtual uint32_t num_particles() const = 0;
+    // current particles, including those died since the last compaction. Waits for the simulation to finish.
+    virtual void read_particles(std::vector<Particle> &particles) = 0;
+
+    // stages timed by backends, a backend may leave some of them unused
+    enum Stage {
+        eStageEmit,
+        eStageUpdate,
+        eStageScan1,
+        eStageScan2,
+        eStageScan3,
+        // 'compact.comp' of three-pass compaction, or the whole compaction when it's a single step
+        eStageCompact,
+        eNumStages,
+    };
+    static const char *stage_name(uint32_t stage) {
+        const char *names[] = { "emit", "update", "scan1", "scan2", "scan3", "compact" };
+        return names[stage];
+    }
+    struct StageStats {
+        SampleWindow::Stats time;
+        // estimated bytes read and written, the last time the stage was executed
+        uint64_t bytes = 0;
+    };
+    virtual StageStats stage_stats(uint32_t stage) const = 0;
+
+    // settings of the backend, into the current ImGui window
+    virtual void draw_ui() {}
+};
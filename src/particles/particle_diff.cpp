@@ -0,0 +1,69 @@
+#include "particle_diff.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+static_assert(kNumParticleFloats == 12);
+
+const char *particle_float_name(uint32_t index) {
+    const char *names[kNumParticleFloats] = {
+        "position.x", "position.y", "position.z", "mass",
+        "velocity.x", "velocity.y", "velocity.z", "life",
+        "acceleration.x", "acceleration.y", "acceleration.z", "size",
+    };
+    return names[index];
+}
+
+const ParticleTolerance &ParticleTolerances::operator[](uint32_t float_index) const {
+    const ParticleTolerance *tolerances[kNumParticleFloats] = {
+        &position, &position, &position, &mass,
+        &velocity, &velocity, &velocity, &life,
+        &acceleration, &acceleration, &acceleration, &size,
+    };
+    return *tolerances[float_index];
+}
+
+uint32_t ulp_distance(float a, float b) {
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) && std::isnan(b) ? 0 : std::numeric_limits<uint32_t>::max();
+    }
+    // bits of negative floats are mirrored, so that integers are in the same order as floats, with 0 and -0 equal
+    auto to_ordered = [](float x) {
+        auto bits = static_cast<int64_t>(std::bit_cast<int32_t>(x));
+        return bits < 0 ? std::numeric_limits<int32_t>::min() - bits : bits;
+    };
+    auto distance = std::abs(to_ordered(a) - to_ordered(b));
+    return static_cast<uint32_t>(std::min<int64_t>(distance, std::numeric_limits<uint32_t>::max()));
+}
+
+ParticleDiff diff_particles(
+    const std::vector<Particle> &a, const std::vector<Particle> &b, const ParticleTolerances &tolerances
+) {
+    ParticleDiff diff;
+    diff.num_particles[0] = static_cast<uint32_t>(a.size());
+    diff.num_particles[1] = static_cast<uint32_t>(b.size());
+
+    auto num_particles = std::min(a.size(), b.size());
+    for (size_t i = 0; i < num_particles; i++) {
+        auto a_floats = reinterpret_cast<const float *>(&a[i]);
+        auto b_floats = reinterpret_cast<const float *>(&b[i]);
+        for (uint32_t index = 0; index < kNumParticleFloats; index++) {
+            auto ulps = ulp_distance(a_floats[index], b_floats[index]);
+            auto abs = std::abs(a_floats[index] - b_floats[index]);
+            diff.max_ulps[index] = std::max(diff.max_ulps[index], ulps);
+            diff.max_abs[index] = std::max(diff.max_abs[index], abs);
+
+            const auto &tolerance = tolerances[index];
+            if (!diff.diverged && ulps > tolerance.max_ulps && !(abs <= tolerance.max_abs)) {
+                diff.diverged = true;
+                diff.first_diverging = static_cast<uint32_t>(i);
+                diff.first_diverging_float = index;
+                diff.first_diverging_particles[0] = a[i];
+                diff.first_diverging_particles[1] = b[i];
+            }
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "particle_backend.hpp"
+
+// floats of 'Particle', in memory order
+constexpr uint32_t kNumParticleFloats = sizeof(Particle) / sizeof(float);
+// such as "position.x"
+const char *particle_float_name(uint32_t index);
+
+// A float is within tolerance if it's at most 'max_ulps' or 'max_abs' away from the other one,
+// the latter for values around zero, where ulps are tiny.
+struct ParticleTolerance {
+    uint32_t max_ulps;
+    float max_abs;
+};
+// Defaults allow for sin, cos and pow, which differ between GPU and CPU, and for the error they cause to build up
+// over a few hundred frames. Life, mass and size don't go through them.
+struct ParticleTolerances {
+    ParticleTolerance position { 4096, 1e-5f };
+    ParticleTolerance velocity { 4096, 1e-5f };
+    ParticleTolerance acceleration { 4096, 1e-5f };
+    ParticleTolerance mass { 1, 0.0f };
+    ParticleTolerance life { 1, 0.0f };
+    ParticleTolerance size { 1, 0.0f };
+
+    const ParticleTolerance &operator[](uint32_t float_index) const;
+};
+
+// Float by float comparison of particles of two backends, see 'diff_particles()'.
+struct ParticleDiff {
+    uint32_t num_particles[2] = {};
+    // largest differences of each float over compared particles
+    uint32_t max_ulps[kNumParticleFloats] = {};
+    float max_abs[kNumParticleFloats] = {};
+
+    // first particle with a float out of tolerance
+    bool diverged = false;
+    uint32_t first_diverging = 0;
+    uint32_t first_diverging_float = 0;
+    Particle first_diverging_particles[2] = {};
+
+    bool passed() const { return num_particles[0] == num_particles[1] && !diverged; }
+};
+
+// distance between 'a' and 'b' in representable floats, NaN is only equal to NaN
+uint32_t ulp_distance(float a, float b);
+
+// particles are expected in the same order, only the common prefix is compared when their numbers differ
+ParticleDiff diff_particles(
+    const std::vector<Particle> &a, const std::vector<Particle> &b, const ParticleTolerances &tolerances = {}
+);
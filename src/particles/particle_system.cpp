@@ -1,6 +1,10 @@
 #include "particle_system.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <numbers>
+#include <string>
 
 #include <cmrc/cmrc.hpp>
 #include <glad/glad.h>
@@ -8,81 +12,110 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-CMRC_DECLARE(shaders_spv);
+#include "gl_utils.hpp"
+
 CMRC_DECLARE(assets);
 
 namespace {
 
-constexpr uint32_t kScanWidth = 512;
-constexpr uint32_t kMaxNumParticles = kScanWidth * kScanWidth;
-
-struct alignas(16) Particle {
-    glm::vec3 position;
-    float mass;
-    glm::vec3 velocity;
-    float life;
-    glm::vec3 acceleration;
-    float size;
-};
+// billboard draws are only timed with enough particles, as few of them cost about the same either way
+constexpr uint32_t kBillboardDrawTimingMinParticles = 256 * 1024;
+// samples of each draw before picking one
+constexpr uint32_t kBillboardDrawTimingFrames = 32;
 
-struct alignas(16) ParticleEmissionSettings {
-    glm::vec3 position;
-    float position_radius;
-    glm::vec3 velocity;
-    float velocity_angle_cos;
-    float mass_min;
-    float mass_max;
-    float life_min;
-    float life_max;
-    float size_min;
-    float size_max;
-};
-struct EmitParams {
-    uint32_t offset;
-    uint32_t count;
-    uint32_t seed;
-};
+// see 'draw.vert'
+constexpr uint32_t kMaxBillboardCorners = 8;
 
-struct alignas(16) UpdateParams {
-    glm::vec3 force;
-    float delta_time;
-    uint32_t num_particles;
-    float gravity;
-    float drag;
-};
+// of the emitter, in seconds
+constexpr float kMaxLife = 1000.0f;
 
 struct alignas(16) RenderParams {
     glm::vec4 color;
+    float viewport_height;
+    uint32_t billboard_num_indices;
+    // xy of each corner of the billboard polygon
+    alignas(16) glm::vec4 billboard_corners[kMaxBillboardCorners];
+};
+
+const std::vector<glm::vec2> kQuadPolygon = {
+    glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f)
 };
 
-void build_compute_program(std::unique_ptr<GlComputeProgram> &program, const char *spv_path) {
-    auto spv_file = cmrc::shaders_spv::get_filesystem().open(spv_path);
-    assert(spv_file.size() > 0 && spv_file.size() % 4 == 0);
-    std::vector<uint8_t> spv_data(spv_file.size());
-    std::copy(spv_file.begin(), spv_file.end(), spv_data.data());
-    GlShader shader(spv_data.data(), static_cast<uint32_t>(spv_file.size()), GL_COMPUTE_SHADER);
-    program = std::make_unique<GlComputeProgram>(shader);
+// Octagon containing every texel of 'rgba' with some alpha, in texture coordinates. Its edges face the axes and
+// the diagonals, each as close to the center as those texels allow. Texels are grown by half a texel, which is
+// as far as bilinear filtering carries their alpha. Corners where edges meet at the same point are merged.
+std::vector<glm::vec2> fit_alpha_octagon(const uint8_t *rgba, int width, int height) {
+    constexpr uint32_t kNumEdges = 8;
+    const glm::vec2 center(0.5f);
+    glm::vec2 normals[kNumEdges];
+    float distances[kNumEdges];
+    for (uint32_t i = 0; i < kNumEdges; i++) {
+        float angle = static_cast<float>(i) * std::numbers::pi_v<float> / 4.0f;
+        normals[i] = glm::vec2(std::cos(angle), std::sin(angle));
+        distances[i] = -std::numeric_limits<float>::infinity();
+    }
+
+    glm::vec2 texel_size(1.0f / width, 1.0f / height);
+    bool transparent = true;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (rgba[(y * width + x) * 4 + 3] == 0) {
+                continue;
+            }
+            transparent = false;
+            for (int corner = 0; corner < 4; corner++) {
+                glm::vec2 texel_corner(x - 0.5f + 2 * (corner & 1), y - 0.5f + 2 * (corner >> 1));
+                auto offset = texel_corner * texel_size - center;
+                for (uint32_t i = 0; i < kNumEdges; i++) {
+                    distances[i] = std::max(distances[i], glm::dot(normals[i], offset));
+                }
+            }
+        }
+    }
+    if (transparent) {
+        return kQuadPolygon;
+    }
+
+    // within the quad. Each diagonal edge is then kept from passing beyond the corner where its neighbours meet,
+    // which only happens because of the quad, so that consecutive edges meet at corners of the octagon.
+    for (uint32_t i = 0; i < kNumEdges; i += 2) {
+        distances[i] = std::min(distances[i], 0.5f);
+    }
+    for (uint32_t i = 1; i < kNumEdges; i += 2) {
+        float neighbours = distances[i - 1] + distances[(i + 1) % kNumEdges];
+        distances[i] = std::min(distances[i], neighbours / std::numbers::sqrt2_v<float>);
+    }
+
+    std::vector<glm::vec2> corners;
+    for (uint32_t i = 0; i < kNumEdges; i++) {
+        auto n0 = normals[i];
+        auto n1 = normals[(i + 1) % kNumEdges];
+        float d0 = distances[i];
+        float d1 = distances[(i + 1) % kNumEdges];
+        float det = n0.x * n1.y - n0.y * n1.x;
+        auto corner = center + glm::vec2(d0 * n1.y - n0.y * d1, n0.x * d1 - d0 * n1.x) / det;
+        if (corners.empty() || glm::distance(corners.back(), corner) > 1e-5f) {
+            corners.push_back(corner);
+        }
+    }
+    if (corners.size() > 1 && glm::distance(corners.front(), corners.back()) <= 1e-5f) {
+        corners.pop_back();
+    }
+    return corners;
 }
 
-void build_graphics_program(
-    std::unique_ptr<GlGraphicsProgram> &program, const char *vs_spv_path, const char *fs_spv_path
-) {
-    auto vs_spv_file = cmrc::shaders_spv::get_filesystem().open(vs_spv_path);
-    assert(vs_spv_file.size() > 0 && vs_spv_file.size() % 4 == 0);
-    std::vector<uint8_t> vs_spv_data(vs_spv_file.size());
-    std::copy(vs_spv_file.begin(), vs_spv_file.end(), vs_spv_data.data());
-    GlShader vs_shader(vs_spv_data.data(), static_cast<uint32_t>(vs_spv_file.size()), GL_VERTEX_SHADER);
-    
-    auto fs_spv_file = cmrc::shaders_spv::get_filesystem().open(fs_spv_path);
-    assert(fs_spv_file.size() > 0 && fs_spv_file.size() % 4 == 0);
-    std::vector<uint8_t> fs_spv_data(fs_spv_file.size());
-    std::copy(fs_spv_file.begin(), fs_spv_file.end(), fs_spv_data.data());
-    GlShader fs_shader(fs_spv_data.data(), static_cast<uint32_t>(fs_spv_file.size()), GL_FRAGMENT_SHADER);
-
-    program = std::make_unique<GlGraphicsProgram>(vs_shader, fs_shader);
+float polygon_area(const std::vector<glm::vec2> &polygon) {
+    float area = 0.0f;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        auto a = polygon[i];
+        auto b = polygon[(i + 1) % polygon.size()];
+        area += a.x * b.y - a.y * b.x;
+    }
+    return 0.5f * area;
 }
 
-void read_texture(std::unique_ptr<GlTexture2D> &texture, const char *path) {
+// 'alpha_polygon' is fitted to the alpha of the texture, see 'fit_alpha_octagon()', or the quad without alpha
+void read_texture(std::unique_ptr<GlTexture2D> &texture, std::vector<glm::vec2> &alpha_polygon, const char *path) {
     auto file = cmrc::assets::get_filesystem().open(path);
     std::vector<uint8_t> file_data(file.size());
     std::copy(file.begin(), file.end(), file_data.data());
@@ -92,10 +125,12 @@ void read_texture(std::unique_ptr<GlTexture2D> &texture, const char *path) {
     int height;
     auto img_data = stbi_load_from_memory(file_data.data(), file.size(), &width, &height, &num_channels, 0);
 
+    alpha_polygon = kQuadPolygon;
     if (num_channels == 4) {
         texture = std::make_unique<GlTexture2D>(GL_RGBA8, width, height);
         texture->set_data(img_data);
         texture->generate_mipmap();
+        alpha_polygon = fit_alpha_octagon(img_data, width, height);
     } else if (num_channels == 3) {
         texture = std::make_unique<GlTexture2D>(GL_RGB8, width, height);
         texture->set_data(img_data);
@@ -110,13 +145,11 @@ void read_texture(std::unique_ptr<GlTexture2D> &texture, const char *path) {
 
 }
 
-ParticleSystem::ParticleSystem() : rng_(std::random_device{}()) {
-    particles_buffer_[0] = std::make_unique<GlBuffer>(kMaxNumParticles * sizeof(Particle));
-    particles_buffer_[1] = std::make_unique<GlBuffer>(kMaxNumParticles * sizeof(Particle));
+ParticleSystem::ParticleSystem(GlUploadRing &upload_ring, uint32_t max_num_particles)
+    : rng_(std::random_device{}()), upload_ring_(upload_ring), max_num_particles_(max_num_particles) {
+    gpu_backend_ = std::make_unique<GpuParticleBackend>(upload_ring, max_num_particles);
+    cpu_backend_ = std::make_unique<CpuParticleBackend>(max_num_particles);
 
-    init_pipeline_emit();
-    init_pipeline_update();
-    init_pipeline_compact();
     init_pipeline_draw();
 }
 
@@ -125,71 +158,218 @@ ParticleSystem::~ParticleSystem() {
 }
 
 void ParticleSystem::update(float delta_time) {
+    draw_profiler_.begin_frame();
+    fragment_counter_.begin_frame();
     draw_ui();
 
-    if (executing_) {
-        if (emit_settings_.emit_interval > 0 && ++emit_counter_ == emit_settings_.emit_interval) {
-            do_emit();
-            emit_counter_ = 0;
+    // the backend not drawn is only run for cross check, GPU goes first so that CPU work overlaps it
+    ParticleBackend *backends[] = { gpu_backend_.get(), cpu_backend_.get() };
+    auto simulated = [&](uint32_t type) { return cross_check_ || type == backend_type_; };
+
+    // steps simulated this frame, emission and compaction intervals count steps
+    uint32_t num_steps = executing_ ? 1 : 0;
+    float step_time = delta_time;
+    if (executing_ && update_settings_.fixed_time_step) {
+        step_time = update_settings_.time_step;
+        time_accumulator_ += delta_time;
+        num_steps = static_cast<uint32_t>(time_accumulator_ / step_time);
+        if (num_steps > update_settings_.max_substeps) {
+            // too far behind, catching up would only make frames longer
+            num_steps = update_settings_.max_substeps;
+            time_accumulator_ = 0.0;
+        } else {
+            time_accumulator_ -= num_steps * static_cast<double>(step_time);
         }
-        if (num_particles_ > 0) {
-            do_update(delta_time);
+    }
+    last_num_substeps_ = num_steps;
+
+    if (num_steps > 0) {
+        // emissions due within the frame are merged into one at its beginning
+        bool emit = false;
+        bool compact = false;
+        ParticleEmitParams emit_params {};
+        for (uint32_t step = 0; step < num_steps; step++) {
+            if (emit_settings_.emit_interval > 0 && ++emit_counter_ == emit_settings_.emit_interval) {
+                emit_counter_ = 0;
+                auto params = make_emit_params();
+                if (emit) {
+                    emit_params.count += params.count;
+                } else {
+                    emit_params = params;
+                    emit = true;
+                }
+            }
             if (emit_settings_.compact_interval > 0 && ++compact_counter_ == emit_settings_.compact_interval) {
-                do_compact();
+                compact = true;
                 compact_counter_ = 0;
             }
         }
+        emit = emit && emit_params.count > 0;
+
+        ParticleUpdateParams update_params {
+            .force = update_settings_.force,
+            .delta_time = step_time,
+            .gravity = update_settings_.gravity,
+            .drag = update_settings_.drag,
+            .num_substeps = num_steps,
+        };
+
+        for (uint32_t type = 0; type < 2; type++) {
+            if (!simulated(type)) {
+                continue;
+            }
+            if (emit) {
+                backends[type]->emit(emit_params);
+            }
+            backends[type]->update(update_params, compact);
+            if (compact) {
+                backends[type]->compact();
+            }
+        }
+
+        if (cross_check_) {
+            do_cross_check();
+        }
     }
-    if (num_particles_ > 0) {
-        do_draw();
+    for (uint32_t type = 0; type < 2; type++) {
+        if (simulated(type)) {
+            backends[type]->end_frame();
+        }
     }
 
+    // the viewport is set by the window, querying it doesn't wait for GPU
+    GLint viewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    viewport_width_ = static_cast<uint32_t>(viewport[2]);
+    viewport_height_ = static_cast<uint32_t>(viewport[3]);
+
+    if (backend_type_ == eBackendGpu) {
+        gpu_backend_->set_billboard_num_indices(billboard_num_indices());
+        gpu_backend_->prepare_draw(camera_buffer_, camera_view_, viewport_height_);
+    }
+
+    bool timed = pick_billboard_draw();
+    auto &draw_profiler = timed ? *billboard_draw_profiler_ : draw_profiler_;
+    draw_profiler.begin(timed ? billboard_draw_ : 0);
+    do_draw();
+    draw_profiler.end();
+
     glUseProgram(0);
 }
 
-void ParticleSystem::init_pipeline_emit() {
-    build_compute_program(emit_program_, "particle/emit.comp.spv");
+void ParticleSystem::set_backend(BackendType type) {
+    if (backend_type_ != type) {
+        backend_type_ = type;
+        reset();
+    }
+}
 
-    emit_settings_buffer_ = std::make_unique<GlBuffer>(sizeof(ParticleEmissionSettings), GL_MAP_WRITE_BIT);
-    emit_params_buffer_ = std::make_unique<GlBuffer>(sizeof(EmitParams), GL_MAP_WRITE_BIT);
+void ParticleSystem::set_cross_check(bool cross_check) {
+    if (cross_check_ != cross_check) {
+        cross_check_ = cross_check;
+        // both backends start from the same state
+        reset();
+    }
 }
 
-void ParticleSystem::init_pipeline_update() {
-    build_compute_program(update_program_, "particle/update.comp.spv");
+uint32_t ParticleSystem::billboard_num_indices() const {
+    return 3 * (static_cast<uint32_t>(billboard_polygons_[billboard_shape_].size()) - 2);
+}
 
-    update_params_buffer_ = std::make_unique<GlBuffer>(sizeof(UpdateParams), GL_MAP_WRITE_BIT);
+void ParticleSystem::set_billboard_draw(BillboardDraw draw) {
+    billboard_draw_ = draw;
+    billboard_draw_auto_ = false;
+    billboard_draw_profiler_.reset();
 }
 
-void ParticleSystem::init_pipeline_compact() {
-    build_compute_program(compact_program_, "particle/compact.comp.spv");
-    build_compute_program(scan1_program_, "particle/scan1.comp.spv");
-    build_compute_program(scan2_program_, "particle/scan2.comp.spv");
-    build_compute_program(scan3_program_, "particle/scan3.comp.spv");
-
-    compact_indices_buffer_ = std::make_unique<GlBuffer>(kMaxNumParticles * sizeof(uint32_t));
-    scan_buffer_[0] = std::make_unique<GlBuffer>(kScanWidth * sizeof(uint32_t));
-    scan_buffer_[1] = std::make_unique<GlBuffer>(sizeof(uint32_t), GL_MAP_READ_BIT);
-    scan_params_buffer_[0] = std::make_unique<GlBuffer>(sizeof(uint32_t), GL_MAP_WRITE_BIT);
-    scan_params_buffer_[1] = std::make_unique<GlBuffer>(sizeof(uint32_t), GL_MAP_WRITE_BIT);
+void ParticleSystem::set_billboard_draw_auto() {
+    billboard_draw_auto_ = true;
+    billboard_draw_picked_ = false;
+    billboard_draw_profiler_.reset();
+    billboard_draw_timing_frame_ = 0;
 }
 
-void ParticleSystem::init_pipeline_draw() {
-    build_graphics_program(draw_program_, "particle/draw.vert.spv", "particle/draw.frag.spv");
+bool ParticleSystem::pick_billboard_draw() {
+    if (!billboard_draw_auto_ || billboard_draw_picked_) {
+        return false;
+    }
+    if (backend().num_particles() < kBillboardDrawTimingMinParticles) {
+        billboard_draw_ = eBillboardDrawInstanced;
+        return false;
+    }
 
-    draw_params_buffer_ = std::make_unique<GlBuffer>(sizeof(RenderParams), GL_MAP_WRITE_BIT);
+    if (!billboard_draw_profiler_) {
+        billboard_draw_profiler_ = std::make_unique<GlProfiler>(eNumBillboardDraws);
+    }
+    billboard_draw_profiler_->begin_frame();
+    bool timed = true;
+    for (uint32_t draw = 0; draw < eNumBillboardDraws; draw++) {
+        auto stats = billboard_draw_profiler_->stats(draw);
+        billboard_draw_ms_[draw] = stats.avg_ms;
+        timed = timed && stats.count >= kBillboardDrawTimingFrames;
+    }
+    if (timed) {
+        bool pulled_faster = billboard_draw_ms_[eBillboardDrawPulled] < billboard_draw_ms_[eBillboardDrawInstanced];
+        billboard_draw_ = pulled_faster ? eBillboardDrawPulled : eBillboardDrawInstanced;
+        billboard_draw_picked_ = true;
+        billboard_draw_profiler_.reset();
+        return false;
+    }
 
+    // alternate frames, so that both draws see the same particles
+    billboard_draw_ = static_cast<BillboardDraw>(billboard_draw_timing_frame_++ % eNumBillboardDraws);
+    return true;
+}
+
+void ParticleSystem::reset() {
+    gpu_backend_->reset();
+    cpu_backend_->reset();
+    emit_counter_ = 0;
+    compact_counter_ = 0;
+    time_accumulator_ = 0.0;
+    cross_check_diff_ = {};
+}
+
+void ParticleSystem::init_pipeline_draw() {
     glCreateVertexArrays(1, &draw_vao_);
 
-    const uint32_t billboard_index[] = { 0, 1, 2, 0, 2, 3 };
+    uint32_t billboard_index[3 * (kMaxBillboardCorners - 2)];
+    for (uint32_t triangle = 0; triangle < kMaxBillboardCorners - 2; triangle++) {
+        billboard_index[3 * triangle] = 0;
+        billboard_index[3 * triangle + 1] = triangle + 1;
+        billboard_index[3 * triangle + 2] = triangle + 2;
+    }
     billboard_index_buffer_ = std::make_unique<GlBuffer>(sizeof(billboard_index), 0, billboard_index);
     glVertexArrayElementBuffer(draw_vao_, billboard_index_buffer_->id());
 
-    read_texture(billboard_tex_, "assets/circle.png");
+    billboard_polygons_[eBillboardShapeQuad] = kQuadPolygon;
+    read_texture(billboard_tex_, billboard_polygons_[eBillboardShapeFitted], "assets/circle.png");
+
+    build_draw_program(GpuParticleBackend::eLayoutFull, false, false);
+}
+
+void ParticleSystem::build_draw_program(
+    GpuParticleBackend::ParticleLayout layout, bool use_indices, bool pull_vertices
+) {
+    // variants by particle layout, see 'CMakeLists.txt'
+    const char *layout_prefixes[] = { "", "packed/", "soa/" };
+    std::string vs_path = std::string(layout_prefixes[layout]) + "particle/draw.vert.spv";
+    const GlSpecConstant draw_spec[] = {
+        { 0, use_indices },
+        { 1, pull_vertices },
+    };
+    build_graphics_program(draw_program_, vs_path.c_str(), "particle/draw.frag.spv", draw_spec);
+    std::string point_vs_path = std::string(layout_prefixes[layout]) + "particle/draw_point.vert.spv";
+    build_graphics_program(draw_point_program_, point_vs_path.c_str(), "particle/draw_point.frag.spv");
+
+    draw_program_layout_ = layout;
+    draw_program_use_indices_ = use_indices;
+    draw_program_pull_vertices_ = pull_vertices;
 }
 
 void ParticleSystem::draw_ui() {
     if (ImGui::Begin("Particle System")) {
-        ImGui::Text("num particles: %u", num_particles_);
+        ImGui::Text("num particles: %u", backend().num_particles());
 
         if (executing_) {
             executing_ = !ImGui::Button("pause");
@@ -197,47 +377,72 @@ void ParticleSystem::draw_ui() {
             executing_ = ImGui::Button("resume");
         }
 
+        const char *backend_types[] = { "gpu", "cpu" };
+        int backend_type = backend_type_;
+        if (ImGui::Combo("backend", &backend_type, backend_types, IM_ARRAYSIZE(backend_types))) {
+            set_backend(static_cast<BackendType>(backend_type));
+        }
+        bool cross_check = cross_check_;
+        if (ImGui::Checkbox("cross check", &cross_check)) {
+            set_cross_check(cross_check);
+        }
+        if (cross_check_) {
+            draw_cross_check_ui();
+        }
+
+        ImGui::Separator();
+        ImGui::Text("gpu backend");
+        gpu_backend_->draw_ui();
+        ImGui::Separator();
+        ImGui::Text("cpu backend");
+        cpu_backend_->draw_ui();
+
+        ImGui::Separator();
+        draw_profiler_ui();
+
         ImGui::Separator();
         ImGui::Text("emit");
 
-        emit_settings_dirty_ |= ImGui::DragInt(
+        ImGui::DragInt(
             "emit interval", reinterpret_cast<int *>(&emit_settings_.emit_interval),
             1.0f, 0, 10
         );
-        emit_settings_dirty_ |= ImGui::DragInt(
+        ImGui::DragInt(
             "compact interval", reinterpret_cast<int *>(&emit_settings_.compact_interval),
             1.0f, 0, 10
         );
 
-        emit_settings_dirty_ |= ImGui::DragIntRange2(
+        ImGui::DragIntRange2(
             "num emitted",
             reinterpret_cast<int *>(&emit_settings_.count_min),
             reinterpret_cast<int *>(&emit_settings_.count_max),
-            1.0f, 0, kMaxNumParticles
+            1.0f, 0, static_cast<int>(std::min<uint32_t>(max_num_particles_, INT32_MAX))
         );
 
-        emit_settings_dirty_ |= ImGui::DragFloat3(
+        ImGui::DragFloat3(
             "position", &emit_settings_.position.x, 0.05f, -100.0f, 100.0f
         );
-        emit_settings_dirty_ |= ImGui::DragFloat(
+        ImGui::DragFloat(
             "radius", &emit_settings_.position_radius, 0.05f, 0.0f, 100.0f
         );
-        emit_settings_dirty_ |= ImGui::DragFloat3(
+        ImGui::DragFloat3(
             "velocity", &emit_settings_.velocity.x, 0.05f, -100.0f, 100.0f
         );
-        emit_settings_dirty_ |= ImGui::DragFloat(
+        ImGui::DragFloat(
             "angle", &emit_settings_.velocity_angle, 1.0f, 0.0f, 180.0f
         );
 
-        emit_settings_dirty_ |= ImGui::DragFloatRange2(
+        ImGui::DragFloatRange2(
             "life", &emit_settings_.life_min, &emit_settings_.life_max,
-            0.1f, 0.01f, 1000.0f
+            0.1f, 0.01f, max_life()
         );
-        emit_settings_dirty_ |= ImGui::DragFloatRange2(
+        emit_settings_.life_min = std::min(emit_settings_.life_min, max_life());
+        emit_settings_.life_max = std::min(emit_settings_.life_max, max_life());
+        ImGui::DragFloatRange2(
             "mass", &emit_settings_.mass_min, &emit_settings_.mass_max,
             0.01f, 0.01f, 100.0f
         );
-        emit_settings_dirty_ |= ImGui::DragFloatRange2(
+        ImGui::DragFloatRange2(
             "size", &emit_settings_.size_min, &emit_settings_.size_max,
             0.01f, 0.01f, 100.0f
         );
@@ -248,199 +453,264 @@ void ParticleSystem::draw_ui() {
         ImGui::DragFloat3("force", &update_settings_.force.x, 0.01f, -100.0f, 100.0f);
         ImGui::DragFloat("gravity", &update_settings_.gravity, 0.01f, 0.0f, 100.0f);
         ImGui::DragFloat("drag", &update_settings_.drag, 0.01f, 0.0f, 100.0f);
+        ImGui::Checkbox("fixed time step", &update_settings_.fixed_time_step);
+        if (update_settings_.fixed_time_step) {
+            ImGui::DragFloat("time step", &update_settings_.time_step, 0.0001f, 0.0005f, 0.1f, "%.4f s");
+            int max_substeps = update_settings_.max_substeps;
+            if (ImGui::SliderInt("max substeps", &max_substeps, 1, 32)) {
+                update_settings_.max_substeps = max_substeps;
+            }
+            ImGui::Text("substeps: %u", last_num_substeps_);
+        }
 
         ImGui::Separator();
         ImGui::Text("render");
 
-        render_settings_dirty_ |= ImGui::ColorEdit4("color", &render_settings_.color.x);
-    }
-    ImGui::End();
-}
-
-void ParticleSystem::do_emit() {
-    if (emit_settings_dirty_) {
-        auto data = emit_settings_buffer_->typed_map<ParticleEmissionSettings>(true);
-        data->position = emit_settings_.position;
-        data->position_radius = emit_settings_.position_radius;
-        data->velocity = emit_settings_.velocity;
-        data->velocity_angle_cos = std::cos(emit_settings_.velocity_angle / 180.0f * std::numbers::pi);
-        data->life_min = emit_settings_.life_min;
-        data->life_max = emit_settings_.life_max;
-        data->mass_min = emit_settings_.mass_min;
-        data->mass_max = emit_settings_.mass_max;
-        data->size_min = emit_settings_.size_min;
-        data->size_max = emit_settings_.size_max;
-        emit_settings_buffer_->unmap();
-        emit_settings_dirty_ = false;
-    }
+        ImGui::ColorEdit4("color", &render_settings_.color.x);
 
-    std::uniform_real_distribution<> rng01(0.0f, 1.0f);
-    uint32_t num_emitted =
-        emit_settings_.count_min + rng01(rng_) * (emit_settings_.count_max - emit_settings_.count_min);
-    num_emitted = std::min(num_emitted, kMaxNumParticles - num_particles_);
-    if (num_emitted == 0) {
-        return;
-    }
+        const char *billboard_draws[] = { "instanced", "vertex pulling", "auto" };
+        int billboard_draw = billboard_draw_auto_ ? eNumBillboardDraws : billboard_draw_;
+        if (ImGui::Combo("billboard draw", &billboard_draw, billboard_draws, IM_ARRAYSIZE(billboard_draws))) {
+            if (billboard_draw == eNumBillboardDraws) {
+                set_billboard_draw_auto();
+            } else {
+                set_billboard_draw(static_cast<BillboardDraw>(billboard_draw));
+            }
+        }
+        if (billboard_draw_auto_) {
+            if (billboard_draw_picked_) {
+                ImGui::Text(
+                    "picked %s: %.3f ms instanced, %.3f ms pulled", billboard_draws[billboard_draw_],
+                    billboard_draw_ms_[eBillboardDrawInstanced], billboard_draw_ms_[eBillboardDrawPulled]
+                );
+            } else {
+                ImGui::Text("timing from %u particles", kBillboardDrawTimingMinParticles);
+            }
+        }
 
-    {
-        auto data = emit_params_buffer_->typed_map<EmitParams>(true);
-        data->offset = num_particles_;
-        data->count = num_emitted;
-        data->seed = emit_seed_++;
-        emit_params_buffer_->unmap();
+        const char *billboard_shapes[] = { "quad", "fitted octagon" };
+        int billboard_shape = billboard_shape_;
+        if (ImGui::Combo("billboard shape", &billboard_shape, billboard_shapes, IM_ARRAYSIZE(billboard_shapes))) {
+            set_billboard_shape(static_cast<BillboardShape>(billboard_shape));
+        }
+        ImGui::Text(
+            "%zu corners, %.1f%% of the quad", billboard_polygons_[billboard_shape_].size(),
+            100.0f * polygon_area(billboard_polygons_[billboard_shape_])
+        );
+        // pipeline statistics, any overdraw of blended billboards is fragment work
+        ImGui::Checkbox("count fragments", &count_fragments_);
+        if (count_fragments_) {
+            double num_pixels = std::max(double(viewport_width_) * viewport_height_, 1.0);
+            ImGui::Text(
+                "billboard fragments: %.2f M, %.2f per pixel", fragment_counter_.count() / 1e6,
+                fragment_counter_.count() / num_pixels
+            );
+        }
     }
-    num_particles_ += num_emitted;
-
-    glUseProgram(emit_program_->id());
-    uint32_t buffers[] = {
-        particles_buffer_[curr_particles_index_]->id(),
-        emit_settings_buffer_->id(),
-        emit_params_buffer_->id(),
-    };
-    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, buffers);
-    glBindBuffersBase(GL_UNIFORM_BUFFER, 1, 2, buffers + 1);
-
-    glDispatchCompute((num_emitted + 255) / 256, 1, 1);
-
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    ImGui::End();
 }
 
-void ParticleSystem::do_update(float delta_time) {
-    {
-        auto data = update_params_buffer_->typed_map<UpdateParams>(true);
-        data->delta_time = delta_time;
-        data->num_particles = num_particles_;
-        data->force = update_settings_.force;
-        data->gravity = update_settings_.gravity;
-        data->drag = update_settings_.drag;
-        update_params_buffer_->unmap();
+void ParticleSystem::draw_profiler_ui() {
+    // stages of the drawn backend, traffic is estimated from the particle count, assuming that every particle is alive
+    if (ImGui::BeginTable("profiler", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("stage");
+        ImGui::TableSetupColumn("avg ms");
+        ImGui::TableSetupColumn("max ms");
+        ImGui::TableSetupColumn("count");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("GB/s");
+        ImGui::TableHeadersRow();
+
+        // stages of the backend, culling and sorting of GPU backend, then the draw
+        uint32_t num_gpu_draw_stages = backend_type_ == eBackendGpu ? GpuParticleBackend::eNumDrawStages : 0;
+        uint32_t num_rows = ParticleBackend::eNumStages + num_gpu_draw_stages + 1;
+        for (uint32_t row = 0; row < num_rows; row++) {
+            const char *name = "draw";
+            ParticleBackend::StageStats stats { draw_profiler_.stats(0), draw_bytes_ };
+            if (row < ParticleBackend::eNumStages) {
+                name = ParticleBackend::stage_name(row);
+                stats = backend().stage_stats(row);
+            } else if (row + 1 < num_rows) {
+                name = GpuParticleBackend::draw_stage_name(row - ParticleBackend::eNumStages);
+                stats = gpu_backend_->draw_stage_stats(row - ParticleBackend::eNumStages);
+            }
+            auto megabytes = stats.bytes / (1024.0 * 1024.0);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.time.avg_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.time.max_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", stats.time.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", megabytes);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", stats.time.avg_ms > 0.0f ? megabytes / 1024.0 / (stats.time.avg_ms * 1e-3) : 0.0);
+        }
+        ImGui::EndTable();
     }
-
-    glUseProgram(update_program_->id());
-    uint32_t buffers[] = {
-        particles_buffer_[curr_particles_index_]->id(),
-        update_params_buffer_->id(),
-    };
-    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, buffers);
-    glBindBuffersBase(GL_UNIFORM_BUFFER, 1, 1, buffers + 1);
-
-    glDispatchCompute((num_particles_ + 255) / 256, 1, 1);
-
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void ParticleSystem::do_compact() {
-    auto num_blocks = (num_particles_ + 511) / 512;
-    {
-        auto data0 = scan_params_buffer_[0]->typed_map<uint32_t>(true);
-        *data0 = num_particles_;
-        scan_params_buffer_[0]->unmap();
-
-        auto data1 = scan_params_buffer_[1]->typed_map<uint32_t>(true);
-        *data1 = num_blocks;
-        scan_params_buffer_[1]->unmap();
-    }
-
-    // scan 1
-    {
-        glUseProgram(scan1_program_->id());
-        uint32_t buffers[] = {
-            particles_buffer_[curr_particles_index_]->id(),
-            compact_indices_buffer_->id(),
-            scan_buffer_[0]->id(),
-            scan_params_buffer_[0]->id(),
-        };
-        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 3, buffers);
-        glBindBuffersBase(GL_UNIFORM_BUFFER, 3, 1, buffers + 3);
-
-        glDispatchCompute(num_blocks, 1, 1);
-
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    }
-
-    // scan 2
-    {
-        glUseProgram(scan2_program_->id());
-        uint32_t buffers[] = {
-            scan_buffer_[0]->id(),
-            scan_buffer_[1]->id(),
-            scan_params_buffer_[1]->id(),
-        };
-        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 2, buffers);
-        glBindBuffersBase(GL_UNIFORM_BUFFER, 2, 1, buffers + 2);
-
-        glDispatchCompute(1, 1, 1);
-
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+void ParticleSystem::draw_cross_check_ui() {
+    // only expected to match in compact allocation mode with full or structure of arrays layout,
+    // and up to the precision of transcendental functions, which differs between GPU and CPU
+    const auto &diff = cross_check_diff_;
+    ImGui::Text("particles: %u gpu, %u cpu", diff.num_particles[eBackendGpu], diff.num_particles[eBackendCpu]);
+    if (diff.diverged) {
+        auto index = diff.first_diverging_float;
+        auto gpu_value = reinterpret_cast<const float *>(&diff.first_diverging_particles[eBackendGpu])[index];
+        auto cpu_value = reinterpret_cast<const float *>(&diff.first_diverging_particles[eBackendCpu])[index];
+        ImGui::Text(
+            "first diverging: particle %u, %s %g gpu, %g cpu",
+            diff.first_diverging, particle_float_name(index), gpu_value, cpu_value
+        );
+    } else {
+        ImGui::Text("within tolerance");
     }
 
-    // scan 3
-    if (num_blocks > 1) {
-        glUseProgram(scan3_program_->id());
-        uint32_t buffers[] = {
-            compact_indices_buffer_->id(),
-            scan_buffer_[0]->id(),
-            scan_params_buffer_[0]->id(),
-        };
-        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 2, buffers);
-        glBindBuffersBase(GL_UNIFORM_BUFFER, 2, 1, buffers + 2);
-
-        glDispatchCompute(num_blocks - 1, 1, 1);
-
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    if (ImGui::BeginTable("cross check", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("float");
+        ImGui::TableSetupColumn("max ulps");
+        ImGui::TableSetupColumn("max error");
+        ImGui::TableHeadersRow();
+        for (uint32_t index = 0; index < kNumParticleFloats; index++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(particle_float_name(index));
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", diff.max_ulps[index]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%g", diff.max_abs[index]);
+        }
+        ImGui::EndTable();
     }
+}
 
-    // compact
-    {
-        glUseProgram(compact_program_->id());
-        uint32_t buffers[] = {
-            particles_buffer_[curr_particles_index_]->id(),
-            compact_indices_buffer_->id(),
-            particles_buffer_[curr_particles_index_ ^ 1]->id(),
-            scan_params_buffer_[0]->id(),
-        };
-        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 3, buffers);
-        glBindBuffersBase(GL_UNIFORM_BUFFER, 3, 1, buffers + 3);
+float ParticleSystem::max_life() const {
+    bool packed = gpu_backend_->particle_layout() == GpuParticleBackend::eLayoutPacked;
+    return packed ? GpuParticleBackend::kPackedLifeRange : kMaxLife;
+}
 
-        glDispatchCompute(num_blocks, 1, 1);
-    }
+ParticleEmitParams ParticleSystem::make_emit_params() {
+    std::uniform_real_distribution<> rng01(0.0f, 1.0f);
 
-    curr_particles_index_ ^= 1;
+    ParticleEmitParams params;
+    params.position = emit_settings_.position;
+    params.position_radius = emit_settings_.position_radius;
+    params.velocity = emit_settings_.velocity;
+    params.velocity_angle_cos = std::cos(emit_settings_.velocity_angle / 180.0f * std::numbers::pi);
+    // rather than cut on GPU only, which would simulate other particles than the CPU backend
+    params.life_min = std::min(emit_settings_.life_min, max_life());
+    params.life_max = std::min(emit_settings_.life_max, max_life());
+    params.mass_min = emit_settings_.mass_min;
+    params.mass_max = emit_settings_.mass_max;
+    params.size_min = emit_settings_.size_min;
+    params.size_max = emit_settings_.size_max;
+    params.count = emit_settings_.count_min + rng01(rng_) * (emit_settings_.count_max - emit_settings_.count_min);
+    params.seed = emit_seed_++;
+    return params;
+}
 
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
-    auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
-    glDeleteSync(fence);
+void ParticleSystem::do_cross_check() {
+    auto &gpu_particles = cross_check_particles_[eBackendGpu];
+    auto &cpu_particles = cross_check_particles_[eBackendCpu];
+    gpu_backend_->read_particles(gpu_particles);
+    cpu_backend_->read_particles(cpu_particles);
 
-    auto data = scan_buffer_[1]->typed_map<uint32_t>();
-    num_particles_ = *data;
-    scan_buffer_[1]->unmap();
+    cross_check_diff_ = diff_particles(gpu_particles, cpu_particles);
 }
 
 void ParticleSystem::do_draw() {
-    if (render_settings_dirty_) {
-        auto data = draw_params_buffer_->typed_map<RenderParams>(true);
+    GlBufferRange params_range;
+    {
+        auto data = upload_ring_.typed_allocate<RenderParams>(params_range);
         data->color = render_settings_.color;
-        draw_params_buffer_->unmap();
-        render_settings_dirty_ = false;
+        data->viewport_height = static_cast<float>(viewport_height_);
+        data->billboard_num_indices = billboard_num_indices();
+        const auto &polygon = billboard_polygons_[billboard_shape_];
+        for (size_t i = 0; i < polygon.size(); i++) {
+            data->billboard_corners[i] = glm::vec4(polygon[i], 0.0f, 0.0f);
+        }
     }
 
     // glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glUseProgram(draw_program_->id());
-    uint32_t buffers[] = {
-        particles_buffer_[curr_particles_index_]->id(),
-        camera_buffer_->id(),
-        draw_params_buffer_->id(),
-    };
-    glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, buffers);
-    glBindBuffersBase(GL_UNIFORM_BUFFER, 1, 2, buffers + 1);
+    bool pull_vertices = billboard_draw_ == eBillboardDrawPulled;
+    if (backend_type_ == eBackendGpu) {
+        auto layout = gpu_backend_->particle_layout();
+        auto use_indices = gpu_backend_->draw_uses_indices();
+        if (draw_program_layout_ != layout || draw_program_use_indices_ != use_indices
+            || draw_program_pull_vertices_ != pull_vertices) {
+            build_draw_program(layout, use_indices, pull_vertices);
+        }
+        draw_bytes_ = uint64_t(gpu_backend_->num_particles()) * gpu_backend_->draw_footprint();
+
+        glUseProgram(draw_program_->id());
+        gpu_backend_->bind_draw_buffers();
+    } else {
+        if (draw_program_layout_ != GpuParticleBackend::eLayoutFull || draw_program_use_indices_
+            || draw_program_pull_vertices_ != pull_vertices) {
+            build_draw_program(GpuParticleBackend::eLayoutFull, false, pull_vertices);
+        }
+
+        // gathered into full layout and uploaded as a whole
+        auto &particles = cpu_draw_particles_;
+        cpu_backend_->read_particles(particles);
+        uint64_t size = particles.size() * sizeof(Particle);
+        draw_bytes_ = 2 * size;
+        if (size == 0) {
+            return;
+        }
+        if (!cpu_particles_buffer_ || cpu_particles_buffer_->size() < size) {
+            auto old_size = cpu_particles_buffer_ ? cpu_particles_buffer_->size() : 0;
+            resize_buffer(cpu_particles_buffer_, std::max(size, 2 * old_size), 0, GL_DYNAMIC_STORAGE_BIT);
+        }
+        glNamedBufferSubData(cpu_particles_buffer_->id(), 0, size, particles.data());
+
+        glUseProgram(draw_program_->id());
+        uint32_t particles_buffer = cpu_particles_buffer_->id();
+        glBindBuffersBase(GL_SHADER_STORAGE_BUFFER, 0, 1, &particles_buffer);
+    }
+    bind_uniform_buffer(1, camera_buffer_);
+    bind_uniform_buffer(2, params_range);
     glBindTextureUnit(3, billboard_tex_->id());
     glBindVertexArray(draw_vao_);
 
-    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, num_particles_);
+    if (count_fragments_) {
+        fragment_counter_.begin();
+    }
+    if (backend_type_ == eBackendGpu) {
+        auto indirect = reinterpret_cast<const void *>(gpu_backend_->draw_indirect_offset(pull_vertices));
+        if (pull_vertices) {
+            glDrawArraysIndirect(GL_TRIANGLES, indirect);
+        } else {
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, indirect);
+        }
+        if (count_fragments_) {
+            fragment_counter_.end();
+        }
+        // points aren't sorted, they barely cover anything
+        if (gpu_backend_->draws_points()) {
+            glUseProgram(draw_point_program_->id());
+            gpu_backend_->bind_point_draw_buffers();
+            glDrawArraysIndirect(GL_POINTS, reinterpret_cast<const void *>(gpu_backend_->point_draw_indirect_offset()));
+        }
+    } else {
+        auto num_particles = static_cast<int>(cpu_backend_->num_particles());
+        auto num_indices = static_cast<int>(billboard_num_indices());
+        if (pull_vertices) {
+            glDrawArrays(GL_TRIANGLES, 0, num_indices * num_particles);
+        } else {
+            glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, nullptr, num_particles);
+        }
+        if (count_fragments_) {
+            fragment_counter_.end();
+        }
+    }
 
     glBindVertexArray(0);
 }
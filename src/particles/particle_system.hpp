@@ -2,35 +2,96 @@
 
 #include <memory>
 #include <random>
+#include <vector>
 
+#include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "../glh/resource.hpp"
 #include "../glh/program.hpp"
+#include "../glh/profiler.hpp"
+#include "../glh/query_counter.hpp"
+#include "gpu_particle_backend.hpp"
+#include "cpu_particle_backend.hpp"
+#include "particle_diff.hpp"
 
 class ParticleSystem {
 public:
-    ParticleSystem();
+    static constexpr uint32_t kDefaultMaxNumParticles = 16 * 1024 * 1024;
+
+    // buffers grow geometrically on demand, up to 'max_num_particles'
+    ParticleSystem(GlUploadRing &upload_ring, uint32_t max_num_particles = kDefaultMaxNumParticles);
     ~ParticleSystem();
 
-    void set_camera_buffer(const GlBuffer *camera_buffer) { camera_buffer_ = camera_buffer; }
+    // 'view' is the view matrix held by 'camera_buffer'
+    void set_camera_buffer(const GlBufferRange &camera_buffer, const glm::mat4 &view) {
+        camera_buffer_ = camera_buffer;
+        camera_view_ = view;
+    }
 
     void update(float delta_time);
 
+    enum BackendType {
+        eBackendGpu,
+        eBackendCpu,
+    };
+    void set_backend(BackendType type);
+
+    // run both backends on the same input and compare their particles every frame, which waits for GPU
+    void set_cross_check(bool cross_check);
+
+    enum BillboardDraw {
+        // one instance of 4 indexed vertices per particle
+        eBillboardDrawInstanced,
+        // a single instance of 6 vertices per particle, pulled by 'draw.vert' from gl_VertexID
+        eBillboardDrawPulled,
+        eNumBillboardDraws,
+    };
+    void set_billboard_draw(BillboardDraw draw);
+    // both draws are timed on alternate frames once there are enough particles, then the faster one is kept
+    void set_billboard_draw_auto();
+
+    enum BillboardShape {
+        // the whole texture
+        eBillboardShapeQuad,
+        // octagon fitted to the alpha of the texture, so that fewer fragments blend nothing
+        eBillboardShapeFitted,
+        eNumBillboardShapes,
+    };
+    void set_billboard_shape(BillboardShape shape) { billboard_shape_ = shape; }
+
+    GpuParticleBackend &gpu_backend() { return *gpu_backend_; }
+    CpuParticleBackend &cpu_backend() { return *cpu_backend_; }
+
+    void reset();
+
 private:
-    void init_pipeline_emit();
-    void init_pipeline_update();
-    void init_pipeline_compact();
+    ParticleBackend &backend() {
+        return backend_type_ == eBackendGpu ? static_cast<ParticleBackend &>(*gpu_backend_) : *cpu_backend_;
+    }
+
     void init_pipeline_draw();
+    // draw programs for particles of 'layout', billboards go through an index list if 'use_indices',
+    // and their vertices are pulled from gl_VertexID if 'pull_vertices'
+    void build_draw_program(GpuParticleBackend::ParticleLayout layout, bool use_indices, bool pull_vertices);
+    // picks the billboard draw of this frame in auto mode, returns whether it's timed
+    bool pick_billboard_draw();
+    // of the polygon of the current billboard shape
+    uint32_t billboard_num_indices() const;
 
     void draw_ui();
-    void do_emit();
-    void do_update(float delta_time);
-    void do_compact();
+    void draw_profiler_ui();
+    void draw_cross_check_ui();
+    ParticleEmitParams make_emit_params();
+    // longest life of emitted particles, which the packed layout limits
+    float max_life() const;
+    void do_cross_check();
     void do_draw();
 
     std::mt19937 rng_;
 
+    GlUploadRing &upload_ring_;
+
     struct {
         uint32_t emit_interval = 1;
         uint32_t compact_interval = 1;
@@ -51,42 +112,70 @@ private:
         glm::vec3 force = glm::vec3(0.0f);
         float gravity = 9.8f;
         float drag = 0.0f;
+        // frame time is accumulated and simulated in steps of 'time_step', all steps of a frame are run
+        // by a single update, at most 'max_substeps' of them, and time beyond is dropped
+        bool fixed_time_step = false;
+        float time_step = 1.0f / 120.0f;
+        uint32_t max_substeps = 8;
     } update_settings_;
     struct {
         glm::vec4 color = glm::vec4(1.0f);
     } render_settings_;
 
+    uint32_t max_num_particles_;
     bool executing_ = true;
     uint32_t emit_counter_ = 0;
     uint32_t compact_counter_ = 0;
-
-    uint32_t num_particles_ = 0;
-    uint32_t curr_particles_index_ = 0;
-    std::unique_ptr<GlBuffer> particles_buffer_[2];
-
-    std::unique_ptr<GlComputeProgram> emit_program_;
-    std::unique_ptr<GlBuffer> emit_settings_buffer_;
-    std::unique_ptr<GlBuffer> emit_params_buffer_;
-    bool emit_settings_dirty_ = true;
     uint32_t emit_seed_ = 0;
-
-    std::unique_ptr<GlComputeProgram> update_program_;
-    std::unique_ptr<GlBuffer> update_params_buffer_;
-
-    std::unique_ptr<GlComputeProgram> scan1_program_;
-    std::unique_ptr<GlComputeProgram> scan2_program_;
-    std::unique_ptr<GlComputeProgram> scan3_program_;
-    std::unique_ptr<GlComputeProgram> compact_program_;
-    std::unique_ptr<GlBuffer> compact_indices_buffer_;
-    std::unique_ptr<GlBuffer> scan_buffer_[2];
-    std::unique_ptr<GlBuffer> scan_params_buffer_[2];
+    // simulated time lags behind by less than a step
+    double time_accumulator_ = 0.0;
+    uint32_t last_num_substeps_ = 1;
+
+    std::unique_ptr<GpuParticleBackend> gpu_backend_;
+    std::unique_ptr<CpuParticleBackend> cpu_backend_;
+    BackendType backend_type_ = eBackendGpu;
+
+    bool cross_check_ = false;
+    // GPU against CPU, indexed by backend type
+    ParticleDiff cross_check_diff_;
+    std::vector<Particle> cross_check_particles_[2];
+
+    // only the draw stage, others are timed by backends
+    GlProfiler draw_profiler_ { 1 };
+    uint64_t draw_bytes_ = 0;
+
+    BillboardDraw billboard_draw_ = eBillboardDrawInstanced;
+    bool billboard_draw_auto_ = true;
+    // draws of frames timed in auto mode, by billboard draw, until one is picked
+    std::unique_ptr<GlProfiler> billboard_draw_profiler_;
+    bool billboard_draw_picked_ = false;
+    uint32_t billboard_draw_timing_frame_ = 0;
+    // of the last pick
+    float billboard_draw_ms_[eNumBillboardDraws] = {};
 
     std::unique_ptr<GlGraphicsProgram> draw_program_;
-    std::unique_ptr<GlBuffer> draw_params_buffer_;
-    bool render_settings_dirty_ = true;
+    // sub-pixel particles of GPU backend, see 'GpuParticleBackend::set_point_lod()'
+    std::unique_ptr<GlGraphicsProgram> draw_point_program_;
+    GpuParticleBackend::ParticleLayout draw_program_layout_ = GpuParticleBackend::eLayoutFull;
+    bool draw_program_use_indices_ = false;
+    bool draw_program_pull_vertices_ = false;
     uint32_t draw_vao_ = 0;
+    // fan of triangles around the first corner, of as many corners as a billboard may have
     std::unique_ptr<GlBuffer> billboard_index_buffer_;
     std::unique_ptr<GlTexture2D> billboard_tex_;
-
-    const GlBuffer *camera_buffer_ = nullptr;
+    BillboardShape billboard_shape_ = eBillboardShapeFitted;
+    // convex polygon of each shape, in texture coordinates and counterclockwise
+    std::vector<glm::vec2> billboard_polygons_[eNumBillboardShapes];
+    // fragment shader invocations of billboards, not of points
+    bool count_fragments_ = false;
+    GlQueryCounter fragment_counter_ { GL_FRAGMENT_SHADER_INVOCATIONS };
+    // particles of CPU backend, uploaded every frame
+    std::vector<Particle> cpu_draw_particles_;
+    std::unique_ptr<GlBuffer> cpu_particles_buffer_;
+
+    GlBufferRange camera_buffer_;
+    glm::mat4 camera_view_ = glm::mat4(1.0f);
+    // of the current viewport, in pixels
+    uint32_t viewport_width_ = 0;
+    uint32_t viewport_height_ = 0;
 };
@@ -0,0 +1,165 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+}
+
+JobSystem::JobSystem(uint32_t num_threads) {
+    num_threads_ = num_threads > 0 ? num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    workers_ = std::make_unique<Worker[]>(num_threads_);
+    for (uint32_t thread = 1; thread < num_threads_; thread++) {
+        threads_.emplace_back(&JobSystem::worker_main, this, thread);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+std::vector<JobSystem::ThreadStats> JobSystem::thread_stats() const {
+    std::vector<ThreadStats> stats(num_threads_);
+    for (uint32_t thread = 0; thread < num_threads_; thread++) {
+        stats[thread] = workers_[thread].stats;
+    }
+    return stats;
+}
+
+void JobSystem::reset_stats() {
+    for (uint32_t thread = 0; thread < num_threads_; thread++) {
+        workers_[thread].stats = {};
+    }
+    parallel_ms_ = 0.0;
+}
+
+void JobSystem::run(uint32_t count, uint32_t chunk_size, ChunkFunc func, const void *context) {
+    if (count == 0) {
+        return;
+    }
+    auto begin_time = Clock::now();
+    uint32_t num_chunks = (count + chunk_size - 1) / chunk_size;
+
+    func_ = func;
+    context_ = context;
+    count_ = count;
+    chunk_size_ = chunk_size;
+    num_remaining_.store(num_chunks, std::memory_order_relaxed);
+
+    // contiguous ranges, so that each thread walks memory linearly until it steals
+    for (uint32_t thread = 0; thread < num_threads_; thread++) {
+        std::lock_guard lock(workers_[thread].mutex);
+        workers_[thread].begin = uint64_t(num_chunks) * thread / num_threads_;
+        workers_[thread].end = uint64_t(num_chunks) * (thread + 1) / num_threads_;
+    }
+    if (num_threads_ > 1) {
+        {
+            std::lock_guard lock(wake_mutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+    }
+
+    while (num_remaining_.load(std::memory_order_acquire) > 0) {
+        if (!run_chunk(0)) {
+            // the last chunks are still running on other threads
+            std::this_thread::yield();
+        }
+    }
+
+    parallel_ms_ += elapsed_ms(begin_time);
+}
+
+void JobSystem::worker_main(uint32_t thread) {
+    while (true) {
+        uint64_t generation;
+        {
+            std::lock_guard lock(wake_mutex_);
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+        }
+
+        while (run_chunk(thread)) {}
+
+        // a loop started after the generation was read wakes this thread up immediately
+        std::unique_lock lock(wake_mutex_);
+        wake_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+    }
+}
+
+bool JobSystem::run_chunk(uint32_t thread) {
+    uint32_t chunk;
+    if (!pop(thread, chunk) && !steal(thread, chunk)) {
+        return false;
+    }
+
+    auto begin_time = Clock::now();
+    uint32_t begin = chunk * chunk_size_;
+    uint32_t end = std::min(begin + chunk_size_, count_);
+    func_(context_, begin, end, thread);
+
+    auto &stats = workers_[thread].stats;
+    stats.busy_ms += elapsed_ms(begin_time);
+    ++stats.num_chunks;
+
+    num_remaining_.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+bool JobSystem::pop(uint32_t thread, uint32_t &chunk) {
+    auto &worker = workers_[thread];
+    std::lock_guard lock(worker.mutex);
+    if (worker.begin == worker.end) {
+        return false;
+    }
+    chunk = --worker.end;
+    return true;
+}
+
+bool JobSystem::steal(uint32_t thread, uint32_t &chunk) {
+    for (uint32_t i = 1; i < num_threads_; i++) {
+        auto &victim = workers_[(thread + i) % num_threads_];
+        uint32_t begin;
+        uint32_t end;
+        {
+            std::lock_guard lock(victim.mutex);
+            if (victim.begin == victim.end) {
+                continue;
+            }
+            // front half, the victim keeps working on the back
+            begin = victim.begin;
+            end = begin + (victim.end - victim.begin + 1) / 2;
+            victim.begin = end;
+        }
+
+        // the own deque is empty, the rest of the stolen range goes there
+        auto &worker = workers_[thread];
+        {
+            std::lock_guard lock(worker.mutex);
+            assert(worker.begin == worker.end);
+            worker.begin = begin + 1;
+            worker.end = end;
+        }
+        worker.stats.num_stolen += end - begin;
+        chunk = begin;
+        return true;
+    }
+    return false;
+}
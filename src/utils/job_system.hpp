@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of threads running parallel loops split into chunks, with work stealing.
+// Chunks of a loop are dealt evenly to per-thread deques. A thread pops chunks from the back of its own deque,
+// and once it's empty, steals the front half of another one, so that threads finishing early help slower ones.
+// The calling thread takes part as thread 0, loops can't be nested.
+class JobSystem {
+public:
+    // 'num_threads' includes the calling thread, 0 for one per hardware thread
+    JobSystem(uint32_t num_threads = 0);
+    ~JobSystem();
+
+    uint32_t num_threads() const { return num_threads_; }
+
+    // runs 'func(begin, end, thread)' over chunks of at most 'chunk_size' of [0, 'count'), and waits for all of them
+    template <typename F>
+    void parallel_for(uint32_t count, uint32_t chunk_size, const F &func) {
+        run(count, chunk_size, [](const void *context, uint32_t begin, uint32_t end, uint32_t thread) {
+            (*static_cast<const F *>(context))(begin, end, thread);
+        }, &func);
+    }
+
+    struct ThreadStats {
+        // time spent running chunks
+        double busy_ms = 0.0;
+        uint32_t num_chunks = 0;
+        // chunks taken from deques of other threads
+        uint32_t num_stolen = 0;
+    };
+    // since the last 'reset_stats()', one per thread
+    std::vector<ThreadStats> thread_stats() const;
+    // time spent in 'parallel_for' since the last 'reset_stats()', utilization of a thread is its busy time over it
+    double parallel_ms() const { return parallel_ms_; }
+    void reset_stats();
+
+private:
+    using ChunkFunc = void (*)(const void *context, uint32_t begin, uint32_t end, uint32_t thread);
+    void run(uint32_t count, uint32_t chunk_size, ChunkFunc func, const void *context);
+    void worker_main(uint32_t thread);
+    // runs a chunk from the own deque of 'thread', or stolen from another one, false if there is none
+    bool run_chunk(uint32_t thread);
+    bool pop(uint32_t thread, uint32_t &chunk);
+    bool steal(uint32_t thread, uint32_t &chunk);
+
+    // on its own cache line, as it's written by its thread for every chunk
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        // remaining chunks of the current loop
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        ThreadStats stats;
+    };
+
+    uint32_t num_threads_;
+    std::unique_ptr<Worker[]> workers_;
+    std::vector<std::thread> threads_;
+
+    // current loop, published to other threads through the mutex of deques
+    ChunkFunc func_ = nullptr;
+    const void *context_ = nullptr;
+    uint32_t count_ = 0;
+    uint32_t chunk_size_ = 0;
+    std::atomic<uint32_t> num_remaining_ = 0;
+
+    // threads sleep when there is no chunk left, until the generation changes
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+
+    double parallel_ms_ = 0.0;
+};
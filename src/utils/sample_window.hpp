@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Last 'window' samples of a time in milliseconds, as a ring.
+class SampleWindow {
+public:
+    SampleWindow(uint32_t window = 64) : samples_(window, 0.0f) {}
+
+    void add(float ms) {
+        samples_[num_samples_ % samples_.size()] = ms;
+        ++num_samples_;
+        total_ms_ += ms;
+    }
+
+    struct Stats {
+        float avg_ms = 0.0f;
+        float max_ms = 0.0f;
+        // number of samples in the window
+        uint32_t count = 0;
+        // over every sample so far
+        double total_ms = 0.0;
+        uint32_t total_count = 0;
+    };
+    Stats stats() const {
+        Stats stats;
+        stats.count = std::min(num_samples_, static_cast<uint32_t>(samples_.size()));
+        stats.total_ms = total_ms_;
+        stats.total_count = num_samples_;
+        if (stats.count == 0) {
+            return stats;
+        }
+
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < stats.count; i++) {
+            sum += samples_[i];
+            stats.max_ms = std::max(stats.max_ms, samples_[i]);
+        }
+        stats.avg_ms = sum / stats.count;
+        return stats;
+    }
+
+private:
+    std::vector<float> samples_;
+    uint32_t num_samples_ = 0;
+    double total_ms_ = 0.0;
+};